@@ -0,0 +1,214 @@
+// Headless benchmark:
+//   gcc -O2 -pthread bench.c bitboard.c position.c movegen.c movepick.c search.c evaluate.c pawns.c nnue.c
+//       material.c endgame.c syzygy.c mapfile.c tt.c -o bench
+//   ./bench [iterations]        move generator throughput
+//   ./bench --search [depth]    fixed-depth search node counts, for comparing search changes
+//     --no <option>             switch a search option off (pvs, aspiration, nullmove, lmr,
+//                               rfp, futility, matedistance); may repeat
+//     --each                    also rerun the suite with each option off in turn
+//   ./bench --eval [depth]      evaluations/sec over the move tree, incremental updates included
+//   --nnue <file>               evaluate with this network in any mode
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "endgame.h"
+#include "evaluate.h"
+#include "nnue.h"
+#include "search.h"
+#include "timer.h"
+#include "tt.h"
+
+static const char *benchPositions[] = {
+    START_FEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+static double secondsSince(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void runBench(int (*generator)(const Position *, Move *), const Position *positions,
+                     int positionCount, long iterations) {
+    Move moves[MAX_MOVES];
+    long long total = 0;
+    clock_t start = clock();
+    for (long n = 0; n < iterations; n++) {
+        total += generator(&positions[n % positionCount], moves);
+    }
+    double elapsed = secondsSince(start);
+    printf("%lld moves in %.3f s, %.0f moves/sec\n", total, elapsed, elapsed > 0 ? total / elapsed : 0.0);
+}
+
+// Searches every position to the same depth from an empty table. The node
+// total only moves when the search itself changes, so it is the number to
+// compare; the time shows what the change costs per node. 'totals' gets the
+// summed nodes, time and pawn cache lookups.
+static void runSearchBench(SearchPool *pool, const Position *positions, int positionCount, int depth, int verbose,
+                           SearchResult *totals) {
+    SearchLimits limits = {depth, 0, 0};
+    memset(totals, 0, sizeof(*totals));
+    for (int i = 0; i < positionCount; i++) {
+        SearchResult result;
+        char buf[6];
+        ttClear();
+        searchPosition(pool, &positions[i], NULL, 0, &limits, &result);
+        moveToString(result.bestMove, buf);
+        if (verbose) {
+            printf("%-5s score %6d nodes %10llu  %8.0f ms\n", buf, result.score, (unsigned long long)result.nodes,
+                   result.timeMs);
+        }
+        totals->nodes += result.nodes;
+        totals->timeMs += result.timeMs;
+        totals->pawnProbes += result.pawnProbes;
+        totals->pawnHits += result.pawnHits;
+        totals->materialProbes += result.materialProbes;
+        totals->materialHits += result.materialHits;
+    }
+}
+
+// With 'each', the suite runs again with every search option switched off in
+// turn, to show what each one is worth against the rest
+static int searchBench(const Position *positions, int positionCount, int depth, int each) {
+    static const char *options[] = {"pvs", "aspiration", "nullmove", "lmr", "rfp", "futility", "matedistance"};
+    SearchPool pool;
+    if (!initSearchPool(&pool, 1) || !ttResize(16)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    SearchResult totals;
+    runSearchBench(&pool, positions, positionCount, depth, !each, &totals);
+    uint64_t nodes = totals.nodes;
+    double ms = totals.timeMs;
+    printf("depth %d: %llu nodes in %.0f ms, %.0f nodes/sec\n", depth, (unsigned long long)nodes, ms,
+           ms > 0 ? nodes * 1000.0 / ms : 0.0);
+    if (totals.pawnProbes) {
+        printf("pawn hash: %.1f%% of %llu lookups hit\n", totals.pawnHits * 100.0 / totals.pawnProbes,
+               (unsigned long long)totals.pawnProbes);
+    }
+    if (totals.materialProbes) {
+        printf("material hash: %.1f%% of %llu lookups hit\n", totals.materialHits * 100.0 / totals.materialProbes,
+               (unsigned long long)totals.materialProbes);
+    }
+    if (each) {
+        SearchOptions saved = searchOptions;
+        for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+            searchOptions = saved;
+            if (!setSearchOption(options[i], 0)) continue;
+            runSearchBench(&pool, positions, positionCount, depth, 0, &totals);
+            uint64_t n = totals.nodes;
+            double t = totals.timeMs;
+            printf("  no %-12s %12llu nodes (%+6.1f%%) %8.0f ms (%+6.1f%%)\n", options[i], (unsigned long long)n,
+                   nodes ? (n * 100.0 / nodes - 100) : 0.0, t, ms > 0 ? (t * 100 / ms - 100) : 0.0);
+        }
+        searchOptions = saved;
+    }
+    freeSearchPool(&pool);
+    return 0;
+}
+
+// Walks the legal move tree to 'depth' with make/unmake, evaluating every
+// node, so incremental updates are timed the way the search uses them
+static uint64_t evalTree(Position *pos, NnueAccumulator *acc, PawnTable *pawns, MaterialTable *material, int depth,
+                         int *sink) {
+    *sink += nnueLoaded() ? nnueEvaluate(pos, acc) : evaluate(pos, pawns, material);
+    if (depth == 0) return 1;
+    Move moves[MAX_MOVES];
+    int count = generateLegalMoves(pos, moves);
+    uint64_t evals = 1;
+    for (int i = 0; i < count; i++) {
+        StateInfo st;
+        nnuePush(acc + 1, pos, moves[i]);
+        makeMove(pos, moves[i], &st);
+        evals += evalTree(pos, acc + 1, pawns, material, depth - 1, sink);
+        unmakeMove(pos, moves[i], &st);
+    }
+    return evals;
+}
+
+static void evalBench(Position *positions, int positionCount, int depth) {
+    NnueAccumulator *stack = malloc(sizeof(NnueAccumulator) * (size_t)(depth + 1));
+    PawnTable *pawns = calloc(1, sizeof(PawnTable));
+    MaterialTable *material = calloc(1, sizeof(MaterialTable));
+    if (!stack || !pawns || !material) {
+        free(stack);
+        free(pawns);
+        free(material);
+        return;
+    }
+    uint64_t evals = 0;
+    int sink = 0;
+    double start = nowMs();
+    for (int i = 0; i < positionCount; i++) {
+        nnueReset(stack);
+        evals += evalTree(&positions[i], stack, pawns, material, depth, &sink);
+    }
+    double ms = nowMs() - start;
+    printf("%s: %llu evaluations in %.0f ms, %.0f evals/sec (checksum %d)\n", nnueLoaded() ? "nnue" : "psq",
+           (unsigned long long)evals, ms, ms > 0 ? evals * 1000.0 / ms : 0.0, sink);
+    if (pawns->probes) printf("pawn hash: %.1f%% of lookups hit\n", pawns->hits * 100.0 / pawns->probes);
+    if (material->probes) printf("material hash: %.1f%% of lookups hit\n", material->hits * 100.0 / material->probes);
+    free(stack);
+    free(pawns);
+    free(material);
+}
+
+int main(int argc, char **argv) {
+    // A network, wherever it is given, applies to every mode
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--nnue") != 0) continue;
+        if (!nnueLoad(argv[i + 1])) {
+            printf("Cannot load network %s\n", argv[i + 1]);
+            return 1;
+        }
+        memmove(&argv[i], &argv[i + 2], sizeof(char *) * (size_t)(argc - i - 1));
+        argc -= 2;
+        break;
+    }
+    int searchMode = argc > 1 && strcmp(argv[1], "--search") == 0;
+    int evalMode = argc > 1 && strcmp(argv[1], "--eval") == 0;
+    long iterations = (argc > 1 && !searchMode && !evalMode) ? atol(argv[1]) : 1000000;
+    int positionCount = (int)(sizeof(benchPositions) / sizeof(benchPositions[0]));
+    Position positions[sizeof(benchPositions) / sizeof(benchPositions[0])];
+
+    initBitboards();
+    initZobrist();
+    initEndgames();
+    for (int i = 0; i < positionCount; i++) {
+        if (!setPositionFromFEN(&positions[i], benchPositions[i])) {
+            printf("Bad FEN: %s\n", benchPositions[i]);
+            return 1;
+        }
+    }
+
+    if (evalMode) {
+        evalBench(positions, positionCount, argc > 2 ? atoi(argv[2]) : 3);
+        return 0;
+    }
+    if (searchMode) {
+        int depth = 6, each = 0;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--each") == 0) {
+                each = 1;
+            } else if (strcmp(argv[i], "--no") == 0 && i + 1 < argc) {
+                if (!setSearchOption(argv[++i], 0)) {
+                    printf("Unknown search option: %s\n", argv[i]);
+                    return 1;
+                }
+            } else {
+                depth = atoi(argv[i]);
+            }
+        }
+        return searchBench(positions, positionCount, depth, each);
+    }
+
+    printf("pseudo-legal: ");
+    runBench(generateMoves, positions, positionCount, iterations);
+    printf("legal:        ");
+    runBench(generateLegalMoves, positions, positionCount, iterations);
+    return 0;
+}
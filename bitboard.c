@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include "bitboard.h"
+#include "magics.h"
+
+Bitboard betweenBB[64][64];
+Bitboard lineBB[64][64];
+Bitboard knightAttacks[64];
+Bitboard kingAttacks[64];
+Bitboard pawnAttacks[2][64];
+Magic rookMagics[64];
+Magic bishopMagics[64];
+
+// 102400 rook and 5248 bishop entries with per-square table sizes
+static Bitboard rookTable[0x19000];
+static Bitboard bishopTable[0x1480];
+
+static const int rookDirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+static const int bishopDirs[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+// Walks from 'from' in steps of (dr, dc) and returns the squares passed
+// before reaching 'to', or 0 if 'to' is not on that ray
+static Bitboard rayBetween(int from, int to, int dr, int dc) {
+    Bitboard b = 0;
+    int r = (from >> 3) + dr, c = (from & 7) + dc;
+    while (r >= 0 && r < 8 && c >= 0 && c < 8) {
+        int sq = r * 8 + c;
+        if (sq == to) return b;
+        b |= SQUARE_BB(sq);
+        r += dr;
+        c += dc;
+    }
+    return 0;
+}
+
+static Bitboard fullLine(int sq, int dr, int dc) {
+    Bitboard b = SQUARE_BB(sq);
+    for (int dir = -1; dir <= 1; dir += 2) {
+        int r = (sq >> 3) + dr * dir, c = (sq & 7) + dc * dir;
+        while (r >= 0 && r < 8 && c >= 0 && c < 8) {
+            b |= SQUARE_BB(r * 8 + c);
+            r += dr * dir;
+            c += dc * dir;
+        }
+    }
+    return b;
+}
+
+static Bitboard slidingAttacks(int sq, Bitboard occupied, const int dirs[4][2]) {
+    Bitboard attacks = 0;
+    for (int d = 0; d < 4; d++) {
+        int r = (sq >> 3) + dirs[d][0], c = (sq & 7) + dirs[d][1];
+        while (r >= 0 && r < 8 && c >= 0 && c < 8) {
+            Bitboard bb = SQUARE_BB(r * 8 + c);
+            attacks |= bb;
+            if (occupied & bb) break;
+            r += dirs[d][0];
+            c += dirs[d][1];
+        }
+    }
+    return attacks;
+}
+
+// Fills the lookup tables for one piece kind from the generated magics
+static void initMagics(Magic magics[64], Bitboard *table, const Bitboard numbers[64], const int dirs[4][2]) {
+    Bitboard *next = table;
+    for (int sq = 0; sq < 64; sq++) {
+        Magic *m = &magics[sq];
+        Bitboard rankEdges = (RANK_1_BB | RANK_8_BB) & ~(RANK_1_BB << (8 * (sq >> 3)));
+        Bitboard fileEdges = 0x8181818181818181ULL & ~(0x0101010101010101ULL << (sq & 7));
+        m->mask = slidingAttacks(sq, 0, dirs) & ~(rankEdges | fileEdges);
+        m->magic = numbers[sq];
+        m->shift = 64 - (unsigned)popCount(m->mask);
+        m->attacks = next;
+
+        // Carry-rippler over every subset of the mask
+        Bitboard b = 0;
+        do {
+            m->attacks[magicIndex(m, b)] = slidingAttacks(sq, b, dirs);
+            b = (b - m->mask) & m->mask;
+        } while (b);
+        next += 1ULL << popCount(m->mask);
+    }
+}
+
+// Set of squares reached by the given (row, col) offsets that stay on the board
+static Bitboard stepAttacks(int sq, const int steps[][2], int count) {
+    Bitboard b = 0;
+    for (int i = 0; i < count; i++) {
+        int r = (sq >> 3) + steps[i][0], c = (sq & 7) + steps[i][1];
+        if (r >= 0 && r < 8 && c >= 0 && c < 8) b |= SQUARE_BB(r * 8 + c);
+    }
+    return b;
+}
+
+void initBitboards(void) {
+    static const int knightSteps[8][2] = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+    static const int kingSteps[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    static const int whitePawnSteps[2][2] = {{1, 1}, {1, -1}};
+    static const int blackPawnSteps[2][2] = {{-1, 1}, {-1, -1}};
+
+    initMagics(rookMagics, rookTable, rookMagicNumbers, rookDirs);
+    initMagics(bishopMagics, bishopTable, bishopMagicNumbers, bishopDirs);
+
+    for (int from = 0; from < 64; from++) {
+        knightAttacks[from] = stepAttacks(from, knightSteps, 8);
+        kingAttacks[from] = stepAttacks(from, kingSteps, 8);
+        pawnAttacks[0][from] = stepAttacks(from, whitePawnSteps, 2);
+        pawnAttacks[1][from] = stepAttacks(from, blackPawnSteps, 2);
+
+        for (int to = 0; to < 64; to++) {
+            betweenBB[from][to] = 0;
+            lineBB[from][to] = 0;
+            if (from == to) continue;
+            int dr = (to >> 3) - (from >> 3);
+            int dc = (to & 7) - (from & 7);
+            if (dr != 0 && dc != 0 && abs(dr) != abs(dc)) continue;
+            int stepR = (dr > 0) - (dr < 0);
+            int stepC = (dc > 0) - (dc < 0);
+            betweenBB[from][to] = rayBetween(from, to, stepR, stepC);
+            lineBB[from][to] = fullLine(from, stepR, stepC);
+        }
+    }
+}
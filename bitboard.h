@@ -0,0 +1,104 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+
+// ------------------ BITBOARD BASICS ------------------
+// One bit per square. Squares are numbered a1 = 0 .. h8 = 63, while the GUI
+// keeps its own rows running from rank 8 (row 0) down to rank 1 (row 7).
+typedef uint64_t Bitboard;
+
+#define SQUARE_BB(sq) (1ULL << (sq))
+#define makeSquare(row, col) ((7 - (row)) * 8 + (col))
+#define squareRow(sq) (7 - ((sq) >> 3))
+#define squareCol(sq) ((sq) & 7)
+#define squareRank(sq) ((sq) >> 3)
+
+#define RANK_1_BB 0x00000000000000FFULL
+#define RANK_2_BB 0x000000000000FF00ULL
+#define RANK_7_BB 0x00FF000000000000ULL
+#define RANK_8_BB 0xFF00000000000000ULL
+#define FILE_A_BB 0x0101010101010101ULL
+
+static inline int popCount(Bitboard b) { return __builtin_popcountll(b); }
+static inline int lsb(Bitboard b) { return __builtin_ctzll(b); }
+
+static inline int popLsb(Bitboard *b) {
+    int sq = lsb(*b);
+    *b &= *b - 1;
+    return sq;
+}
+
+static inline Bitboard fileBB(int file) { return FILE_A_BB << file; }
+
+static inline Bitboard adjacentFilesBB(int file) {
+    return (file > 0 ? fileBB(file - 1) : 0) | (file < 7 ? fileBB(file + 1) : 0);
+}
+
+// Every square on the ranks ahead of 'sq' as seen by 'color' (0 White, 1 Black)
+static inline Bitboard forwardRanksBB(int color, int sq) {
+    int rank = squareRank(sq);
+    return color == 0 ? (rank == 7 ? 0 : ~0ULL << (8 * (rank + 1))) : (1ULL << (8 * rank)) - 1;
+}
+
+// King steps from one square to the other
+static inline int squareDistance(int a, int b) {
+    int dr = squareRank(a) - squareRank(b), dc = squareCol(a) - squareCol(b);
+    dr = dr < 0 ? -dr : dr;
+    dc = dc < 0 ? -dc : dc;
+    return dr > dc ? dr : dc;
+}
+
+// Squares strictly between two aligned squares, and the full line through them
+// (both are empty when the squares do not share a rank, file or diagonal)
+extern Bitboard betweenBB[64][64];
+extern Bitboard lineBB[64][64];
+
+// Precomputed attack sets for the non-sliding pieces
+extern Bitboard knightAttacks[64];
+extern Bitboard kingAttacks[64];
+extern Bitboard pawnAttacks[2][64]; // [color][square]
+
+// ------------------ SLIDING ATTACKS ------------------
+// Rook and bishop attacks come from per-square tables indexed by the
+// relevant occupancy: a magic multiply and shift, or PEXT when BMI2 is on.
+#if defined(__BMI2__) && !defined(NO_PEXT)
+#include <immintrin.h>
+#define USE_PEXT
+#endif
+
+typedef struct {
+    Bitboard mask;     // Relevant occupancy, board edges excluded
+    Bitboard magic;
+    Bitboard *attacks; // Slice of the shared attack table for this square
+    unsigned shift;
+} Magic;
+
+extern Magic rookMagics[64];
+extern Magic bishopMagics[64];
+
+static inline unsigned magicIndex(const Magic *m, Bitboard occupied) {
+#ifdef USE_PEXT
+    return (unsigned)_pext_u64(occupied, m->mask);
+#else
+    return (unsigned)(((occupied & m->mask) * m->magic) >> m->shift);
+#endif
+}
+
+static inline Bitboard rookAttacks(int sq, Bitboard occupied) {
+    const Magic *m = &rookMagics[sq];
+    return m->attacks[magicIndex(m, occupied)];
+}
+
+static inline Bitboard bishopAttacks(int sq, Bitboard occupied) {
+    const Magic *m = &bishopMagics[sq];
+    return m->attacks[magicIndex(m, occupied)];
+}
+
+static inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+    return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied);
+}
+
+void initBitboards(void);
+
+#endif
@@ -0,0 +1,117 @@
+#include <time.h>
+#include "book.h"
+#include "mapfile.h"
+#include "movegen.h"
+#include "polyglot.h"
+
+// Key layout as in Polyglot: 768 piece-square numbers (64 per piece, black
+// pawn first, each white piece after its black one), 4 castling rights,
+// 8 en passant files, then the side-to-move number
+enum { KEY_CASTLING = 768, KEY_EN_PASSANT = 772, KEY_TURN = 780 };
+#define START_KEY 0x463B96181691FC9CULL
+
+static MappedFile bookFile;
+static size_t bookEntries = 0;
+static uint64_t pickState = 0; // Xorshift state for weighted picks
+
+// ------------------ KEYS ------------------
+// The en passant file counts only when a pawn can take, which is when
+// epSquare is set at all
+uint64_t polyglotKey(const Position *pos) {
+    uint64_t key = 0;
+    for (Bitboard b = pos->occupied; b;) {
+        int sq = popLsb(&b);
+        Piece p = pos->board[sq];
+        key ^= random64[64 * (2 * pieceType(p) + (pieceColor(p) == WHITE)) + sq];
+    }
+    for (int i = 0; i < 4; i++) {
+        if (pos->castling & (1 << i)) key ^= random64[KEY_CASTLING + i];
+    }
+    if (pos->epSquare != NO_SQUARE) key ^= random64[KEY_EN_PASSANT + squareCol(pos->epSquare)];
+    if (pos->sideToMove == WHITE) key ^= random64[KEY_TURN];
+    return key;
+}
+
+// Polyglot move: destination in bits 0-5, origin in 6-11, promotion piece
+// (knight 1 to queen 4) in 12-14; castling is the king taking its own rook
+uint16_t polyglotMove(Move move) {
+    int from = moveFrom(move), to = moveTo(move);
+    if (moveFlag(move) == MOVE_CASTLING) to = to > from ? from + 3 : from - 4;
+    int promotion = moveFlag(move) == MOVE_PROMOTION ? movePromotion(move) : 0;
+    return (uint16_t)(to | from << 6 | promotion << 12);
+}
+
+// ------------------ BOOK FILE ------------------
+static uint64_t readBE(const unsigned char *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v = v << 8 | p[i];
+    return v;
+}
+
+// Maps a book, replacing any open before. Returns its entry count, 0 if
+// it cannot be read or the key table does not give the start position its
+// published key.
+size_t bookInit(const char *path) {
+    bookFree();
+    Position start;
+    initPosition(&start);
+    if (polyglotKey(&start) != START_KEY) return 0;
+    if (!mapFile(&bookFile, path)) return 0;
+    bookEntries = bookFile.size / BOOK_ENTRY;
+    pickState = (uint64_t)time(NULL) | 1;
+    return bookEntries;
+}
+
+void bookFree(void) {
+    unmapFile(&bookFile);
+    bookEntries = 0;
+}
+
+// The book moves of a position with their weights, in book order. Entries
+// whose move is not legal here (a key collision) are skipped.
+int bookMoves(const Position *pos, BookMove *moves) {
+    if (!bookEntries) return 0;
+    uint64_t key = polyglotKey(pos);
+    size_t low = 0, high = bookEntries;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (readBE(bookFile.data + mid * BOOK_ENTRY, 8) < key) low = mid + 1;
+        else high = mid;
+    }
+
+    Move legal[MAX_MOVES];
+    int legalCount = generateLegalMoves(pos, legal), count = 0;
+    for (size_t i = low; i < bookEntries && count < BOOK_MAX_MOVES; i++) {
+        const unsigned char *entry = bookFile.data + i * BOOK_ENTRY;
+        if (readBE(entry, 8) != key) break;
+        uint16_t move = (uint16_t)readBE(entry + 8, 2);
+        for (int j = 0; j < legalCount; j++) {
+            if (polyglotMove(legal[j]) == move) {
+                moves[count].move = legal[j];
+                moves[count++].weight = (int)readBE(entry + 10, 2);
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+// A book move chosen at random in proportion to the weights, or MOVE_NONE
+// when the position is not in the book or all its moves weigh nothing
+Move bookProbe(const Position *pos) {
+    BookMove moves[BOOK_MAX_MOVES];
+    int count = bookMoves(pos, moves);
+    long total = 0;
+    for (int i = 0; i < count; i++) total += moves[i].weight;
+    if (total == 0) return MOVE_NONE;
+
+    pickState ^= pickState << 13;
+    pickState ^= pickState >> 7;
+    pickState ^= pickState << 17;
+    long pick = (long)(pickState % (uint64_t)total);
+    for (int i = 0; i < count; i++) {
+        if (pick < moves[i].weight) return moves[i].move;
+        pick -= moves[i].weight;
+    }
+    return MOVE_NONE;
+}
@@ -0,0 +1,29 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stddef.h>
+#include "position.h"
+
+// ------------------ OPENING BOOK ------------------
+// Polyglot .bin books: 16-byte big-endian entries of position key, move,
+// weight and a learning field, sorted by key. The file is memory-mapped
+// and searched in place, so books of any size open at once and the OS
+// reads only the pages a lookup touches.
+#define BOOK_ENTRY 16
+#define BOOK_MAX_MOVES 64 // Most moves kept for one position
+
+// ------------------ STRUCT DEFINITIONS ------------------
+typedef struct {
+    Move move;
+    int weight;
+} BookMove;
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+uint64_t polyglotKey(const Position *pos);
+uint16_t polyglotMove(Move move);
+size_t bookInit(const char *path);
+void bookFree(void);
+int bookMoves(const Position *pos, BookMove *moves);
+Move bookProbe(const Position *pos);
+
+#endif
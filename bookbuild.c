@@ -0,0 +1,390 @@
+// Opening book builder: replays PGN games and writes a Polyglot book (see
+// book.h) of the moves played in their first plies, weighted by results.
+// gcc -O2 -pthread bookbuild.c book.c pgn.c mapfile.c bitboard.c position.c movegen.c evaluate.c pawns.c
+//     material.c endgame.c -o bookbuild
+//   ./bookbuild [options] -o book.bin games.pgn ...
+// Options: --plies N      count the first N plies of each game (default 20)
+//          --threads N    replay games on N threads
+//          --memory MB    counts kept in memory over all threads before they
+//                         are sorted out to a run file (default 256)
+//          --min N        leave out moves played in fewer than N games (default 1)
+//          --tmp DIR      where run files go (default: the current directory)
+// Inputs are mapped and cut into batches at game boundaries (see pgn.h), so
+// neither the games nor the counts need to fit in memory: every thread
+// counts into its own hash table, writes it out sorted when full, and the
+// runs are merged.
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "book.h"
+#include "mapfile.h"
+#include "movegen.h"
+#include "pgn.h"
+#include "timer.h"
+
+#define BATCH_BYTES (4 << 20) // Input handed to a thread at a time
+#define MAX_BATCHES 4096      // Per file; larger files get larger batches
+#define MAX_THREADS 64
+#define MAX_BOOK_PLIES 256
+
+// ------------------ STRUCT DEFINITIONS ------------------
+// Games with this move in this position, by result for the side playing it.
+// An entry with no games is empty.
+typedef struct {
+    uint64_t key;
+    uint16_t move;
+    uint32_t wins, draws, losses;
+} MoveCount;
+
+typedef struct {
+    MoveCount *entries;
+    size_t capacity, count;
+    uint64_t games, skipped, positions;
+} Shard;
+
+typedef struct {
+    const char *text;
+    size_t length;
+} Batch;
+
+static int plyLimit = 20, threadCount = 1, minGames = 1;
+static size_t memoryMb = 256;
+static const char *tmpDir = ".";
+
+// Whole games of the mapped inputs, taken by the threads in turn
+static Batch *batches = NULL;
+static int batchCount = 0, nextBatch = 0;
+static pthread_mutex_t batchLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Sorted run files written so far
+static char **runPaths = NULL;
+static int runCount = 0;
+static pthread_mutex_t runLock = PTHREAD_MUTEX_INITIALIZER;
+
+// ------------------ COUNTING ------------------
+static inline size_t slotOf(const Shard *shard, uint64_t key, uint16_t move) {
+    return (size_t)((key ^ (uint64_t)move * 0x9E3779B97F4A7C15ULL) & (shard->capacity - 1));
+}
+
+static int compareCounts(const void *a, const void *b) {
+    const MoveCount *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (int)x->move - (int)y->move;
+}
+
+// Sorts a shard's entries into a new run file and empties it
+static void spillShard(Shard *shard) {
+    if (!shard->count) return;
+    size_t n = 0;
+    for (size_t i = 0; i < shard->capacity; i++) {
+        MoveCount *e = &shard->entries[i];
+        if (e->wins + e->draws + e->losses) shard->entries[n++] = *e;
+    }
+    qsort(shard->entries, n, sizeof(MoveCount), compareCounts);
+
+    pthread_mutex_lock(&runLock);
+    int number = runCount;
+    char **grown = realloc(runPaths, (size_t)(runCount + 1) * sizeof(char *));
+    char *path = malloc(strlen(tmpDir) + 64);
+    if (!grown || !path) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    runPaths = grown;
+    sprintf(path, "%s/bookbuild-%ld-%d.run", tmpDir, (long)getpid(), number);
+    runPaths[runCount++] = path;
+    pthread_mutex_unlock(&runLock);
+
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(shard->entries, sizeof(MoveCount), n, f) != n || fclose(f)) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        exit(1);
+    }
+    memset(shard->entries, 0, shard->capacity * sizeof(MoveCount));
+    shard->count = 0;
+}
+
+static void addCount(Shard *shard, uint64_t key, uint16_t move, int result) {
+    size_t i = slotOf(shard, key, move);
+    MoveCount *e;
+    for (;; i = (i + 1) & (shard->capacity - 1)) {
+        e = &shard->entries[i];
+        if (!(e->wins + e->draws + e->losses)) break;
+        if (e->key == key && e->move == move) break;
+    }
+    if (!(e->wins + e->draws + e->losses)) {
+        e->key = key;
+        e->move = move;
+        shard->count++;
+    }
+    if (result > 0) e->wins++;
+    else if (result < 0) e->losses++;
+    else e->draws++;
+    if (shard->count * 4 > shard->capacity * 3) spillShard(shard);
+}
+
+// ------------------ PGN ------------------
+// Counts one game from pgnParse: its moves up to the ply limit, each with
+// the result for the side that played it. Games without a result or with a
+// move that cannot be read are skipped.
+static int countGame(const PgnGame *game, void *arg) {
+    Shard *shard = arg;
+    int result = game->result == PGN_WHITE_WINS ? 1 : game->result == PGN_BLACK_WINS ? -1 : 0;
+    Position pos;
+    if (game->result == PGN_UNKNOWN || !pgnStartPosition(game, &pos)) {
+        shard->skipped++;
+        return 1;
+    }
+    uint64_t keys[MAX_BOOK_PLIES];
+    uint16_t played[MAX_BOOK_PLIES];
+    int sides[MAX_BOOK_PLIES];
+    int plies = game->moveCount < plyLimit ? game->moveCount : plyLimit;
+    for (int i = 0; i < plies; i++) {
+        Move move = parseSan(&pos, game->moves[i].san.text, game->moves[i].san.length);
+        if (move == MOVE_NONE) {
+            shard->skipped++;
+            return 1;
+        }
+        keys[i] = polyglotKey(&pos);
+        played[i] = polyglotMove(move);
+        sides[i] = pos.sideToMove;
+        StateInfo st;
+        makeMove(&pos, move, &st);
+    }
+    for (int i = 0; i < plies; i++) addCount(shard, keys[i], played[i], sides[i] == WHITE ? result : -result);
+    shard->games++;
+    shard->positions += (uint64_t)plies;
+    return 1;
+}
+
+// ------------------ THREADS ------------------
+static void *countWorker(void *arg) {
+    Shard *shard = arg;
+    for (;;) {
+        pthread_mutex_lock(&batchLock);
+        int i = nextBatch++;
+        pthread_mutex_unlock(&batchLock);
+        if (i >= batchCount) break;
+        pgnParse(batches[i].text, batches[i].length, countGame, shard);
+    }
+    spillShard(shard);
+    return NULL;
+}
+
+// Maps a file and adds its batches, cut at game boundaries, to the list
+static uint64_t addFile(MappedFile *file, const char *path) {
+    if (!mapFile(file, path)) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 0;
+    }
+    size_t starts[MAX_BATCHES + 1];
+    int parts = (int)(file->size / BATCH_BYTES) + 1;
+    if (parts < threadCount) parts = threadCount;
+    if (parts > MAX_BATCHES) parts = MAX_BATCHES;
+    int count = pgnSplit((const char *)file->data, file->size, parts, starts);
+    Batch *grown = realloc(batches, (size_t)(batchCount + count) * sizeof(Batch));
+    if (!grown) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    batches = grown;
+    for (int i = 0; i < count; i++) {
+        batches[batchCount++] = (Batch){(const char *)file->data + starts[i], starts[i + 1] - starts[i]};
+    }
+    return file->size;
+}
+
+// ------------------ MERGING ------------------
+typedef struct {
+    FILE *file;
+    MoveCount head;
+} RunReader;
+
+static int advanceRun(RunReader *run) {
+    if (run->file && fread(&run->head, sizeof(MoveCount), 1, run->file) == 1) return 1;
+    if (run->file) fclose(run->file);
+    run->file = NULL;
+    return 0;
+}
+
+static void siftDown(RunReader **heap, int count, int i) {
+    for (;;) {
+        int smallest = i, l = 2 * i + 1, r = l + 1;
+        if (l < count && compareCounts(&heap[l]->head, &heap[smallest]->head) < 0) smallest = l;
+        if (r < count && compareCounts(&heap[r]->head, &heap[smallest]->head) < 0) smallest = r;
+        if (smallest == i) return;
+        RunReader *t = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = t;
+        i = smallest;
+    }
+}
+
+static void putBE(unsigned char *p, uint64_t v, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--, v >>= 8) p[i] = (unsigned char)v;
+}
+
+static int compareWeight(const void *a, const void *b) {
+    const MoveCount *x = a, *y = b;
+    uint64_t wx = 2 * (uint64_t)x->wins + x->draws, wy = 2 * (uint64_t)y->wins + y->draws;
+    return wx < wy ? 1 : wx > wy ? -1 : (int)x->move - (int)y->move;
+}
+
+// Writes the moves of one position, heaviest first. A move weighs its
+// points for the side playing it, two per win and one per draw, scaled
+// down with the rest when it would not fit in 16 bits.
+static uint64_t writePosition(FILE *out, MoveCount *moves, size_t count) {
+    size_t kept = 0;
+    uint64_t heaviest = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (moves[i].wins + moves[i].draws + moves[i].losses < (uint32_t)minGames) continue;
+        moves[kept++] = moves[i];
+        uint64_t weight = 2 * (uint64_t)moves[i].wins + moves[i].draws;
+        if (weight > heaviest) heaviest = weight;
+    }
+    qsort(moves, kept, sizeof(MoveCount), compareWeight);
+    uint64_t written = 0;
+    for (size_t i = 0; i < kept; i++) {
+        uint64_t weight = 2 * (uint64_t)moves[i].wins + moves[i].draws;
+        if (heaviest > 65535) weight = weight * 65535 / heaviest;
+        if (!weight) continue; // Never played to a good end: Polyglot skips weight 0 anyway
+        unsigned char entry[BOOK_ENTRY] = {0};
+        putBE(entry, moves[i].key, 8);
+        putBE(entry + 8, moves[i].move, 2);
+        putBE(entry + 10, weight, 2);
+        fwrite(entry, 1, BOOK_ENTRY, out);
+        written++;
+    }
+    return written;
+}
+
+// Merges the sorted runs into the book, adding up counts of the same move.
+// All moves of a key are gathered before any is written, so they are
+// scaled together.
+static uint64_t mergeRuns(const char *outPath) {
+    FILE *out = fopen(outPath, "wb");
+    RunReader *runs = calloc((size_t)runCount + 1, sizeof(RunReader));
+    RunReader **heap = calloc((size_t)runCount + 1, sizeof(RunReader *));
+    size_t capacity = MAX_MOVES;
+    MoveCount *moves = malloc(capacity * sizeof(MoveCount));
+    if (!out || !runs || !heap || !moves) {
+        fprintf(stderr, "Cannot write %s\n", outPath);
+        exit(1);
+    }
+    int heapCount = 0;
+    for (int i = 0; i < runCount; i++) {
+        runs[i].file = fopen(runPaths[i], "rb");
+        if (advanceRun(&runs[i])) heap[heapCount++] = &runs[i];
+    }
+    for (int i = heapCount / 2 - 1; i >= 0; i--) siftDown(heap, heapCount, i);
+
+    uint64_t written = 0;
+    size_t count = 0;
+    while (heapCount) {
+        MoveCount next = heap[0]->head;
+        if (!advanceRun(heap[0])) heap[0] = heap[--heapCount];
+        siftDown(heap, heapCount, 0);
+
+        if (count && moves[count - 1].key == next.key && moves[count - 1].move == next.move) {
+            moves[count - 1].wins += next.wins;
+            moves[count - 1].draws += next.draws;
+            moves[count - 1].losses += next.losses;
+            continue;
+        }
+        if (count && moves[count - 1].key != next.key) {
+            written += writePosition(out, moves, count);
+            count = 0;
+        }
+        if (count == capacity) {
+            // More moves than any position has: positions sharing a key
+            MoveCount *grown = realloc(moves, 2 * capacity * sizeof(MoveCount));
+            if (!grown) {
+                fprintf(stderr, "Out of memory\n");
+                exit(1);
+            }
+            moves = grown;
+            capacity *= 2;
+        }
+        moves[count++] = next;
+    }
+    if (count) written += writePosition(out, moves, count);
+
+    for (int i = 0; i < runCount; i++) {
+        remove(runPaths[i]);
+        free(runPaths[i]);
+    }
+    free(runs), free(heap), free(moves), free(runPaths);
+    if (fclose(out)) written = 0;
+    return written;
+}
+
+int main(int argc, char **argv) {
+    const char *outPath = NULL;
+    int argi = 1;
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        if (strcmp(argv[argi], "-o") == 0 && argi + 1 < argc) outPath = argv[++argi];
+        else if (strcmp(argv[argi], "--plies") == 0 && argi + 1 < argc) plyLimit = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "--threads") == 0 && argi + 1 < argc) threadCount = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "--memory") == 0 && argi + 1 < argc) memoryMb = (size_t)atol(argv[++argi]);
+        else if (strcmp(argv[argi], "--min") == 0 && argi + 1 < argc) minGames = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "--tmp") == 0 && argi + 1 < argc) tmpDir = argv[++argi];
+        else break;
+    }
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_THREADS) threadCount = MAX_THREADS;
+    if (plyLimit < 1) plyLimit = 1;
+    if (plyLimit > MAX_BOOK_PLIES) plyLimit = MAX_BOOK_PLIES;
+    if (!outPath || argi >= argc) {
+        printf("Usage: %s [--plies N] [--threads N] [--memory MB] [--min N] [--tmp DIR] -o book.bin games.pgn...\n",
+               argv[0]);
+        return 1;
+    }
+
+    initBitboards();
+    initZobrist();
+    double start = nowMs();
+
+    uint64_t bytes = 0;
+    int fileCount = argc - argi;
+    MappedFile *files = calloc((size_t)fileCount, sizeof(MappedFile));
+    if (!files) return 1;
+    for (int i = 0; i < fileCount; i++) bytes += addFile(&files[i], argv[argi + i]);
+
+    // Each thread's table is a power of two entries within its share of memory
+    static Shard shards[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    size_t perThread = (memoryMb << 20) / (size_t)threadCount / sizeof(MoveCount), capacity = 1024;
+    while (capacity * 2 <= perThread) capacity *= 2;
+    for (int i = 0; i < threadCount; i++) {
+        shards[i].entries = calloc(capacity, sizeof(MoveCount));
+        shards[i].capacity = capacity;
+        if (!shards[i].entries) {
+            printf("Could not allocate %zu MB for counts\n", memoryMb);
+            return 1;
+        }
+        pthread_create(&threads[i], NULL, countWorker, &shards[i]);
+    }
+
+    uint64_t games = 0, skipped = 0, positions = 0;
+    for (int i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+        games += shards[i].games;
+        skipped += shards[i].skipped;
+        positions += shards[i].positions;
+        free(shards[i].entries);
+    }
+    for (int i = 0; i < fileCount; i++) unmapFile(&files[i]);
+    free(files), free(batches);
+    double counted = nowMs();
+    int runs = runCount;
+    uint64_t entries = mergeRuns(outPath);
+
+    printf("Read %.1f MB: %llu games counted, %llu skipped, %llu positions\n", bytes / 1048576.0,
+           (unsigned long long)games, (unsigned long long)skipped, (unsigned long long)positions);
+    printf("Counting %.2f s (%.1f MB/s), merging %d runs %.2f s\n", (counted - start) / 1000.0,
+           bytes / 1048576.0 / ((counted - start) / 1000.0 + 1e-9), runs, (nowMs() - counted) / 1000.0);
+    printf("Wrote %llu entries to %s\n", (unsigned long long)entries, outPath);
+    return entries || !games ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "egtb.h"
+#include "mapfile.h"
+#include "movegen.h"
+
+#define EGTB_SLOTS 1024 // Hash slots for material keys, two per table
+
+int egtbMaxPieces = 0;
+
+// ------------------ STRUCT DEFINITIONS ------------------
+typedef struct {
+    EgtbMaterial mat;
+    MappedFile file;
+    int valueBits;
+    uint32_t blockCount;
+} EgtbTable;
+
+static EgtbTable *tables = NULL;
+static int tableCount = 0, tableCapacity = 0;
+static int slots[EGTB_SLOTS]; // Table number + 1, 0 when empty
+
+// Squares of the a1-d1-d4 triangle, where the white king of a pawnless
+// table stands
+static const int triangle[10] = {0, 1, 2, 3, 9, 10, 11, 18, 19, 27};
+static int triangleIndex[64];
+static int indexingReady = 0;
+
+static void initIndexing(void) {
+    for (int sq = 0; sq < 64; sq++) triangleIndex[sq] = -1;
+    for (int i = 0; i < 10; i++) triangleIndex[triangle[i]] = i;
+    indexingReady = 1;
+}
+
+// ------------------ MATERIAL ------------------
+// Reads a name such as "KRvKN" or "KPvK". Returns 0 if it is not a
+// material of two kings and at most EGTB_PIECES pieces in all.
+int egtbParseMaterial(EgtbMaterial *m, const char *name) {
+    if (!indexingReady) initIndexing();
+    memset(m, 0, sizeof(*m));
+    const char *v = strchr(name, 'v');
+    if (!v || name[0] != 'K' || v[1] != 'K') return 0;
+
+    int counts[2][6] = {{0}}, swapped[2][6];
+    const char *sides[2][2] = {{name + 1, v}, {v + 2, v + 2 + strlen(v + 2)}};
+    for (int c = WHITE; c <= BLACK; c++) {
+        for (const char *p = sides[c][0]; p < sides[c][1]; p++) {
+            int type = typeIndex(*p);
+            if (type < 0 || type == KING) return 0;
+            counts[c][type]++;
+        }
+        counts[c][KING] = 1;
+    }
+
+    m->count = 2;
+    m->color[0] = WHITE, m->color[1] = BLACK;
+    m->type[0] = m->type[1] = KING;
+    char *out = m->name;
+    for (int c = WHITE; c <= BLACK; c++) {
+        *out++ = 'K';
+        for (int t = QUEEN; t >= PAWN; t--) {
+            for (int n = 0; n < counts[c][t]; n++) {
+                if (m->count == EGTB_PIECES) return 0;
+                m->color[m->count] = c;
+                m->type[m->count++] = t;
+                *out++ = typeChars[t];
+            }
+        }
+        if (c == WHITE) *out++ = 'v';
+    }
+    *out = '\0';
+
+    m->hasPawns = counts[WHITE][PAWN] + counts[BLACK][PAWN] > 0;
+    m->radix[0] = m->hasPawns ? 32 : 10;
+    m->entries = (uint64_t)m->radix[0];
+    for (int i = 1; i < m->count; i++) {
+        m->radix[i] = m->type[i] == PAWN ? 48 : 64;
+        m->entries *= (uint64_t)m->radix[i];
+    }
+    for (int t = PAWN; t <= KING; t++) {
+        swapped[WHITE][t] = counts[BLACK][t];
+        swapped[BLACK][t] = counts[WHITE][t];
+    }
+    m->key = materialKeyOf(counts);
+    m->key2 = materialKeyOf(swapped);
+    return 1;
+}
+
+// ------------------ INDEXING ------------------
+// One of the eight board symmetries: bit 0 mirrors the files, bit 1 the
+// ranks, bit 2 the a1-h8 diagonal. Pawns allow the file mirror only.
+static inline int transformSquare(int sq, int t) {
+    int file = sq & 7, rank = sq >> 3;
+    if (t & 1) file = 7 - file;
+    if (t & 2) rank = 7 - rank;
+    return (t & 4) ? file * 8 + rank : rank * 8 + file;
+}
+
+static inline int sameKind(const EgtbMaterial *m, int i, int j) {
+    return m->color[i] == m->color[j] && m->type[i] == m->type[j];
+}
+
+// The index of a placement, the lowest over its symmetric images with the
+// white king in its region and like pieces in ascending square order
+uint64_t egtbIndex(const EgtbMaterial *m, const int *squares) {
+    uint64_t best = UINT64_MAX;
+    for (int t = 0; t < (m->hasPawns ? 2 : 8); t++) {
+        int sq[EGTB_PIECES];
+        sq[0] = transformSquare(squares[0], t);
+        int king = m->hasPawns ? ((sq[0] & 7) < 4 ? (sq[0] >> 3) * 4 + (sq[0] & 7) : -1) : triangleIndex[sq[0]];
+        if (king < 0) continue;
+
+        uint64_t index = (uint64_t)king;
+        for (int i = 1; i < m->count; i++) {
+            int s = transformSquare(squares[i], t), j = i;
+            for (; j > 1 && sameKind(m, j - 1, i) && sq[j - 1] > s; j--) sq[j] = sq[j - 1];
+            sq[j] = s;
+        }
+        for (int i = 1; i < m->count; i++) {
+            index = index * (uint64_t)m->radix[i] + (uint64_t)(m->type[i] == PAWN ? sq[i] - 8 : sq[i]);
+        }
+        if (index < best) best = index;
+    }
+    return best;
+}
+
+// Squares for an index. Returns 0 if two pieces would share a square or
+// the index is not the one egtbIndex gives that placement: such entries are
+// never probed.
+int egtbDecode(const EgtbMaterial *m, uint64_t index, int *squares) {
+    uint64_t rest = index;
+    for (int i = m->count - 1; i > 0; i--) {
+        int value = (int)(rest % (uint64_t)m->radix[i]);
+        rest /= (uint64_t)m->radix[i];
+        squares[i] = m->type[i] == PAWN ? value + 8 : value;
+    }
+    squares[0] = m->hasPawns ? (int)(rest / 4) * 8 + (int)(rest % 4) : triangle[rest];
+
+    Bitboard seen = 0;
+    for (int i = 0; i < m->count; i++) {
+        if (seen & SQUARE_BB(squares[i])) return 0;
+        seen |= SQUARE_BB(squares[i]);
+    }
+    return egtbIndex(m, squares) == index;
+}
+
+// The squares of a position's pieces in table order. With 'flip' the
+// position is read with colors swapped and the board turned over.
+void egtbSquares(const EgtbMaterial *m, const Position *pos, int flip, int *squares) {
+    Bitboard b = 0;
+    for (int i = 0; i < m->count; i++) {
+        if (i == 0 || !sameKind(m, i - 1, i)) b = pos->pieces[m->color[i] ^ flip][m->type[i]];
+        squares[i] = popLsb(&b) ^ (flip ? 56 : 0);
+    }
+}
+
+// ------------------ TABLE FILES ------------------
+static uint32_t readLE32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t readLE64(const uint8_t *p) {
+    return (uint64_t)readLE32(p) | (uint64_t)readLE32(p + 4) << 32;
+}
+
+static int findSlot(uint64_t key) {
+    int i = (int)(key & (EGTB_SLOTS - 1));
+    while (slots[i] && tables[slots[i] - 1].mat.key != key && tables[slots[i] - 1].mat.key2 != key)
+        i = (i + 1) & (EGTB_SLOTS - 1);
+    return i;
+}
+
+// Maps the file of this material from 'dir' if it is present and its
+// header agrees with the name. Returns whether it was registered.
+static int addTable(const char *dir, const char *white, const char *black) {
+    char name[32], path[4096];
+    snprintf(name, sizeof(name), "K%svK%s", white, black);
+    snprintf(path, sizeof(path), "%s/%s.egtb", dir, name);
+    if (tableCount >= EGTB_SLOTS / 2) return 0;
+    FILE *probe = fopen(path, "rb");
+    if (!probe) return 0;
+    fclose(probe);
+
+    EgtbTable table;
+    memset(&table, 0, sizeof(table));
+    // Either coloring may be on disk; the first one found is used
+    if (!egtbParseMaterial(&table.mat, name) || slots[findSlot(table.mat.key)]) return 0;
+    if (!mapFile(&table.file, path)) return 0;
+    const uint8_t *data = table.file.data;
+    table.valueBits = table.file.size >= EGTB_HEADER ? (int)readLE32(data + 24) : 0;
+    table.blockCount = table.file.size >= EGTB_HEADER ? readLE32(data + 40) : 0;
+    uint64_t blocks = (2 * table.mat.entries + EGTB_BLOCK - 1) / EGTB_BLOCK;
+    if (table.file.size < EGTB_HEADER || memcmp(data, EGTB_MAGIC, 8) || strncmp((const char *)data + 8, name, 16)
+        || readLE32(data + 28) != EGTB_BLOCK || readLE64(data + 32) != table.mat.entries
+        || table.blockCount != blocks || table.valueBits < 1 || table.valueBits > 16
+        || table.file.size < EGTB_HEADER + 8 * (blocks + 1)
+        || readLE64(data + EGTB_HEADER + 8 * blocks) > table.file.size) {
+        fprintf(stderr, "%s: not a valid table file\n", path);
+        unmapFile(&table.file);
+        return 0;
+    }
+
+    if (tableCount == tableCapacity) {
+        int capacity = tableCapacity ? 2 * tableCapacity : 32;
+        EgtbTable *grown = realloc(tables, (size_t)capacity * sizeof(EgtbTable));
+        if (!grown) {
+            unmapFile(&table.file);
+            return 0;
+        }
+        tables = grown;
+        tableCapacity = capacity;
+    }
+    tables[tableCount++] = table;
+    slots[findSlot(table.mat.key)] = tableCount;
+    if (table.mat.key2 != table.mat.key) slots[findSlot(table.mat.key2)] = tableCount;
+    if (table.mat.count > egtbMaxPieces) egtbMaxPieces = table.mat.count;
+    return 1;
+}
+
+// Every set of up to EGTB_PIECES - 2 pieces, written strongest first
+static int collectPieceSets(char sets[][EGTB_PIECES - 1], int count, char *current, int length, int maxType) {
+    memcpy(sets[count], current, (size_t)length);
+    sets[count++][length] = '\0';
+    if (length == EGTB_PIECES - 2) return count;
+    for (int t = maxType; t >= PAWN; t--) {
+        current[length] = typeChars[t];
+        count = collectPieceSets(sets, count, current, length + 1, t);
+    }
+    return count;
+}
+
+// Maps every table found in 'dir', replacing any mapped before. Returns
+// how many were found. Not to be called while other threads probe.
+int egtbInit(const char *dir) {
+    egtbFree();
+    if (!dir || !*dir) return 0;
+    if (!indexingReady) initIndexing();
+
+    static char sets[64][EGTB_PIECES - 1];
+    char current[EGTB_PIECES];
+    int setCount = collectPieceSets(sets, 0, current, 0, QUEEN);
+    for (int i = 0; i < setCount; i++) {
+        for (int j = 0; j < setCount; j++) {
+            if (strlen(sets[i]) + strlen(sets[j]) + 2 > EGTB_PIECES || (!*sets[i] && !*sets[j])) continue;
+            addTable(dir, sets[i], sets[j]);
+        }
+    }
+    return tableCount;
+}
+
+void egtbFree(void) {
+    for (int i = 0; i < tableCount; i++) unmapFile(&tables[i].file);
+    free(tables);
+    tables = NULL;
+    tableCount = tableCapacity = 0;
+    memset(slots, 0, sizeof(slots));
+    egtbMaxPieces = 0;
+}
+
+// ------------------ PROBING ------------------
+static int readValue(const EgtbTable *table, uint64_t n) {
+    const uint8_t *data = table->file.data;
+    uint64_t block = n / EGTB_BLOCK;
+    int offset = (int)(n % EGTB_BLOCK);
+    const uint8_t *p = data + readLE64(data + EGTB_HEADER + 8 * block);
+    const uint8_t *end = data + readLE64(data + EGTB_HEADER + 8 * (block + 1));
+
+    if (*p++ == EGTB_RAW) {
+        uint64_t bit = (uint64_t)offset * (uint64_t)table->valueBits;
+        int value = 0;
+        for (int b = 0; b < table->valueBits; b++, bit++) {
+            if (p + bit / 8 < end && (p[bit / 8] >> (bit % 8) & 1)) value |= 1 << b;
+        }
+        return value;
+    }
+
+    while (p < end) {
+        uint64_t fields[2] = {0, 0};
+        for (int f = 0; f < 2; f++) {
+            for (int shift = 0; p < end && shift < 64; shift += 7) {
+                fields[f] |= (uint64_t)(*p & 127) << shift;
+                if (!(*p++ & 128)) break;
+            }
+        }
+        if ((uint64_t)offset < fields[0]) return (int)fields[1];
+        offset -= (int)fields[0];
+    }
+    return 0;
+}
+
+// Score of the position for the side to move, see EGTB_MATE: 0 for a draw.
+// Sets *success to 0 if no table covers it or castling is still allowed.
+// An en passant capture, which the tables leave out, is tried here.
+int egtbProbe(Position *pos, int *success) {
+    *success = 1;
+    if (pos->occupied == (pos->pieces[WHITE][KING] | pos->pieces[BLACK][KING])) return 0;
+    int slot = slots[findSlot(pos->materialKey)];
+    if (!slot || pos->castling) {
+        *success = 0;
+        return 0;
+    }
+
+    const EgtbTable *table = &tables[slot - 1];
+    int flip = pos->materialKey != table->mat.key;
+    int squares[EGTB_PIECES];
+    egtbSquares(&table->mat, pos, flip, squares);
+    uint64_t n = egtbIndex(&table->mat, squares) + (uint64_t)(pos->sideToMove ^ flip) * table->mat.entries;
+    int score = egtbCodeToScore(readValue(table, n));
+
+    if (pos->epSquare != NO_SQUARE) {
+        Move moves[MAX_MOVES];
+        int count = generateLegalCaptures(pos, moves);
+        for (int i = 0; i < count; i++) {
+            if (moveFlag(moves[i]) != MOVE_EN_PASSANT) continue;
+            StateInfo st;
+            makeMove(pos, moves[i], &st);
+            int child = -egtbProbe(pos, success);
+            unmakeMove(pos, moves[i], &st);
+            if (!*success) return 0;
+            child += child > 0 ? -1 : child < 0 ? 1 : 0;
+            if (child > score) score = child;
+        }
+    }
+    return score;
+}
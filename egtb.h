@@ -0,0 +1,69 @@
+#ifndef EGTB_H
+#define EGTB_H
+
+#include "position.h"
+
+// ------------------ ENDGAME TABLES ------------------
+// Distance-to-mate tables for endings of up to EGTB_PIECES pieces, built by
+// tbgen.c. One file per material, named like "KRvKN.egtb" with the side that
+// is White in the file first; the other coloring is probed by flipping the
+// board. Kings are indexed in a reduced region (a1-d1-d4 without pawns, files
+// a-d with them) so mirrored positions share an entry.
+#define EGTB_PIECES 5
+#define EGTB_MATE 1024 // Scores are EGTB_MATE - plies for a mate, -(EGTB_MATE - plies) when mated
+
+// File layout, little-endian throughout:
+//   0   "EGTBDTM1"
+//   8   name, NUL-padded to 16 bytes
+//   24  uint32 bits per stored value, uint32 values per block
+//   32  uint64 values per side to move
+//   40  uint32 block count, uint32 longest mate in plies, then zeros to 64
+//   64  uint64 offset of each block from the file start, plus one for the end
+// Values for White to move come first, then Black to move, EGTB_BLOCK to a
+// block. A block starts with its encoding: EGTB_RAW packs every value in that
+// many bits, low bits first; EGTB_RLE holds (run length, value) pairs as
+// 7-bit varints. Either way a probe decodes at most one block.
+#define EGTB_MAGIC "EGTBDTM1"
+#define EGTB_HEADER 64
+#define EGTB_BLOCK 4096
+
+enum { EGTB_RAW, EGTB_RLE };
+
+// Stored value: 0 for a draw (or a position that cannot occur), an odd
+// number of plies for a mate by the side to move, plies + 2 (even) for being
+// mated, so that checkmate itself stores 2
+static inline int egtbCodeToScore(int code) {
+    if (!code) return 0;
+    return (code & 1) ? EGTB_MATE - code : -EGTB_MATE + code - 2;
+}
+
+static inline int egtbScoreToCode(int score) {
+    if (!score) return 0;
+    return score > 0 ? EGTB_MATE - score : EGTB_MATE + score + 2;
+}
+
+// ------------------ STRUCT DEFINITIONS ------------------
+// The pieces of one table in index order: White's king, Black's king, then
+// White's other pieces and Black's, each strongest first
+typedef struct {
+    char name[16];
+    int count;
+    int color[EGTB_PIECES], type[EGTB_PIECES];
+    int radix[EGTB_PIECES];   // Values each piece's square takes in the index
+    int hasPawns;
+    uint64_t entries;         // Index range per side to move
+    uint64_t key, key2;       // Material keys as named and with colors swapped
+} EgtbMaterial;
+
+extern int egtbMaxPieces; // Pieces in the largest table found, 0 without any
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+int egtbParseMaterial(EgtbMaterial *m, const char *name);
+uint64_t egtbIndex(const EgtbMaterial *m, const int *squares);
+int egtbDecode(const EgtbMaterial *m, uint64_t index, int *squares);
+void egtbSquares(const EgtbMaterial *m, const Position *pos, int flip, int *squares);
+int egtbInit(const char *dir);
+void egtbFree(void);
+int egtbProbe(Position *pos, int *success);
+
+#endif
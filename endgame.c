@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include "endgame.h"
+#include "evaluate.h"
+
+// ------------------ KPK BITBASE ------------------
+// Every king and pawn against king position, with the pawn's side as White
+// and its pawn on files a-d (the rest mirror), solved by retrograde
+// iteration at startup: one bit per position, set when White wins.
+#define KPK_SIZE (2 * 24 * 64 * 64) // Side to move x pawn square x kings
+
+enum { KPK_INVALID = 0, KPK_UNKNOWN = 1, KPK_DRAW = 2, KPK_WIN = 4 };
+
+static uint32_t kpkWins[KPK_SIZE / 32];
+
+static unsigned kpkIndex(int stm, int blackKing, int whiteKing, int pawn) {
+    return (unsigned)(whiteKing | blackKing << 6 | stm << 12 | squareCol(pawn) << 13 | (6 - squareRank(pawn)) << 15);
+}
+
+// What the position alone tells: illegal, an immediate promotion White
+// keeps, or Black stalemated or taking the pawn for free
+static int kpkInitial(int stm, int blackKing, int whiteKing, int pawn) {
+    if (squareDistance(whiteKing, blackKing) <= 1 || whiteKing == pawn || blackKing == pawn ||
+        (stm == WHITE && (pawnAttacks[WHITE][pawn] & SQUARE_BB(blackKing)))) return KPK_INVALID;
+    if (stm == WHITE && squareRank(pawn) == 6 && whiteKing != pawn + 8 && blackKing != pawn + 8 &&
+        (squareDistance(blackKing, pawn + 8) > 1 || squareDistance(whiteKing, pawn + 8) == 1)) return KPK_WIN;
+    if (stm == BLACK && (!(kingAttacks[blackKing] & ~(kingAttacks[whiteKing] | pawnAttacks[WHITE][pawn])) ||
+                         (kingAttacks[blackKing] & SQUARE_BB(pawn) & ~kingAttacks[whiteKing]))) return KPK_DRAW;
+    return KPK_UNKNOWN;
+}
+
+// White wins if some move reaches a win, Black draws if some move reaches
+// a draw; otherwise known only once every successor is
+static int kpkClassify(const unsigned char *db, int stm, int blackKing, int whiteKing, int pawn) {
+    int good = stm == WHITE ? KPK_WIN : KPK_DRAW;
+    int bad = stm == WHITE ? KPK_DRAW : KPK_WIN;
+    int r = KPK_INVALID;
+    Bitboard b = kingAttacks[stm == WHITE ? whiteKing : blackKing];
+    while (b) {
+        int sq = popLsb(&b);
+        r |= stm == WHITE ? db[kpkIndex(BLACK, blackKing, sq, pawn)] : db[kpkIndex(WHITE, sq, whiteKing, pawn)];
+    }
+    if (stm == WHITE) {
+        if (squareRank(pawn) < 6) r |= db[kpkIndex(BLACK, blackKing, whiteKing, pawn + 8)];
+        if (squareRank(pawn) == 1 && pawn + 8 != whiteKing && pawn + 8 != blackKing) {
+            r |= db[kpkIndex(BLACK, blackKing, whiteKing, pawn + 16)];
+        }
+    }
+    return (r & good) ? good : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : bad;
+}
+
+// Needs initBitboards first
+void initEndgames(void) {
+    unsigned char *db = malloc(KPK_SIZE);
+    if (!db) return; // Every KPK position then reads as a draw
+    for (unsigned i = 0; i < KPK_SIZE; i++) {
+        int pawn = (int)((6 - (i >> 15)) * 8 + ((i >> 13) & 3));
+        db[i] = (unsigned char)kpkInitial((i >> 12) & 1, (i >> 6) & 63, i & 63, pawn);
+    }
+    for (int changed = 1; changed;) {
+        changed = 0;
+        for (unsigned i = 0; i < KPK_SIZE; i++) {
+            if (db[i] != KPK_UNKNOWN) continue;
+            int pawn = (int)((6 - (i >> 15)) * 8 + ((i >> 13) & 3));
+            db[i] = (unsigned char)kpkClassify(db, (i >> 12) & 1, (i >> 6) & 63, i & 63, pawn);
+            changed |= db[i] != KPK_UNKNOWN;
+        }
+    }
+    for (unsigned i = 0; i < KPK_SIZE; i++) {
+        if (db[i] == KPK_WIN) kpkWins[i >> 5] |= 1u << (i & 31);
+    }
+    free(db);
+}
+
+// Whether the pawn's side wins, with that side seen as White
+int kpkProbe(int strongKing, int pawn, int weakKing, int strongToMove) {
+    if (squareCol(pawn) > 3) {
+        strongKing ^= 7;
+        pawn ^= 7;
+        weakKing ^= 7;
+    }
+    unsigned i = kpkIndex(strongToMove ? WHITE : BLACK, weakKing, strongKing, pawn);
+    return (kpkWins[i >> 5] >> (i & 31)) & 1;
+}
+
+// ------------------ EVALUATORS ------------------
+// Larger the nearer the edge, to herd a lone king there
+static int pushToEdge(int sq) {
+    int file = squareCol(sq), rank = squareRank(sq);
+    return 10 * ((file < 4 ? 3 - file : file - 4) + (rank < 4 ? 3 - rank : rank - 4));
+}
+
+// Larger the nearer the kings, since the attacking king must help
+static int pushClose(int a, int b) {
+    return 20 * (7 - squareDistance(a, b));
+}
+
+// Files plus ranks between two squares, so that along an edge the
+// corner itself still scores best
+static int cornerDistance(int sq, int corner) {
+    return abs(squareCol(sq) - squareCol(corner)) + abs(squareRank(sq) - squareRank(corner));
+}
+
+// Enough material against a bare king: drive it to the edge
+int evaluateKXK(const Position *pos, int strongSide) {
+    int strongKing = lsb(pos->pieces[strongSide][KING]);
+    int weakKing = lsb(pos->pieces[!strongSide][KING]);
+    Bitboard bishops = pos->pieces[strongSide][BISHOP];
+    int v = pos->material[strongSide] + pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+    if (pos->pieces[strongSide][QUEEN] || pos->pieces[strongSide][ROOK] ||
+        (bishops && pos->pieces[strongSide][KNIGHT]) ||
+        ((bishops & 0xAA55AA55AA55AA55ULL) && (bishops & 0x55AA55AA55AA55AAULL))) v += KNOWN_WIN;
+    return v;
+}
+
+// Bishop and knight mate only in a corner of the bishop's colour
+int evaluateKBNK(const Position *pos, int strongSide) {
+    int strongKing = lsb(pos->pieces[strongSide][KING]);
+    int weakKing = lsb(pos->pieces[!strongSide][KING]);
+    int bishop = lsb(pos->pieces[strongSide][BISHOP]);
+    int dark = ((squareCol(bishop) + squareRank(bishop)) & 1) == 0; // a1 is dark
+    int a = cornerDistance(weakKing, dark ? 0 : 7), b = cornerDistance(weakKing, dark ? 63 : 56);
+    int corner = a < b ? a : b;
+    return KNOWN_WIN + pushClose(strongKing, weakKing) + 20 * (14 - corner);
+}
+
+int evaluateKPK(const Position *pos, int strongSide) {
+    int strongKing = lsb(pos->pieces[strongSide][KING]);
+    int weakKing = lsb(pos->pieces[!strongSide][KING]);
+    int pawn = lsb(pos->pieces[strongSide][PAWN]);
+    if (strongSide == BLACK) {
+        strongKing ^= 56;
+        weakKing ^= 56;
+        pawn ^= 56;
+    }
+    if (!kpkProbe(strongKing, pawn, weakKing, pos->sideToMove == strongSide)) return 0;
+    return KNOWN_WIN + pieceValue[PAWN] + 10 * squareRank(pawn);
+}
+
+// Neither side can mate
+int evaluateDraw(const Position *pos, int strongSide) {
+    (void)pos;
+    (void)strongSide;
+    return 0;
+}
+
+// ------------------ SCALE FUNCTIONS ------------------
+// Bishops on opposite colours with only pawns besides: the defender's
+// bishop holds a blockade on the squares the other cannot touch, so even
+// a pawn or two up is often a draw
+int scaleOppositeBishops(const Position *pos) {
+    Bitboard light = 0x55AA55AA55AA55AAULL;
+    int whiteLight = (pos->pieces[WHITE][BISHOP] & light) != 0;
+    int blackLight = (pos->pieces[BLACK][BISHOP] & light) != 0;
+    if (whiteLight == blackLight) return SCALE_NORMAL;
+    int diff = popCount(pos->pieces[WHITE][PAWN]) - popCount(pos->pieces[BLACK][PAWN]);
+    return (diff >= -1 && diff <= 1) ? 16 : 32;
+}
@@ -0,0 +1,27 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include "position.h"
+
+// ------------------ SPECIALISED ENDGAMES ------------------
+// Endings the general evaluation gets wrong, recognised by their material
+// (see material.c). An evaluator replaces the evaluation outright; a scale
+// function only shrinks its endgame part towards a draw.
+#define KNOWN_WIN 10000    // Won for sure, but no mate in sight yet
+#define SCALE_NORMAL 64    // Scale factors are in 64ths
+
+// Score for 'strongSide', in centipawns
+typedef int (*EndgameEval)(const Position *pos, int strongSide);
+// Factor for the endgame score, 0 (dead draw) to SCALE_NORMAL
+typedef int (*EndgameScale)(const Position *pos);
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+void initEndgames(void);
+int evaluateKXK(const Position *pos, int strongSide);
+int evaluateKBNK(const Position *pos, int strongSide);
+int evaluateKPK(const Position *pos, int strongSide);
+int evaluateDraw(const Position *pos, int strongSide);
+int scaleOppositeBishops(const Position *pos);
+int kpkProbe(int strongKing, int pawn, int weakKing, int strongToMove);
+
+#endif
@@ -0,0 +1,171 @@
+#include "evaluate.h"
+
+const int pieceValue[6] = {100, 320, 330, 500, 900, 0};
+
+// ------------------ PIECE-SQUARE TABLES ------------------
+// Material by game stage: pawns grow in the endgame, knights shrink
+const int stageValue[2][6] = {
+    {100, 320, 330, 500, 900, 0},
+    {120, 300, 320, 520, 920, 0},
+};
+
+// How much each piece counts towards the middlegame; the start position
+// adds up to PHASE_MAX
+const int phaseWeight[6] = {0, 1, 1, 2, 4, 0};
+
+// Laid out as seen from White's side, rank 8 on the top row, so White looks
+// up sq ^ 56 and Black the square itself
+static const int pawnMg[64] = {
+     0,  0,   0,   0,   0,   0,  0,  0,
+    50, 50,  50,  50,  50,  50, 50, 50,
+    10, 10,  20,  30,  30,  20, 10, 10,
+     5,  5,  10,  25,  25,  10,  5,  5,
+     0,  0,   0,  20,  20,   0,  0,  0,
+     5, -5, -10,   0,   0, -10, -5,  5,
+     5, 10,  10, -20, -20,  10, 10,  5,
+     0,  0,   0,   0,   0,   0,  0,  0,
+};
+
+// A passer's worth is mostly how far it has come
+static const int pawnEg[64] = {
+     0,  0,  0,  0,  0,  0,  0,  0,
+    80, 80, 80, 80, 80, 80, 80, 80,
+    50, 50, 50, 50, 50, 50, 50, 50,
+    30, 30, 30, 30, 30, 30, 30, 30,
+    15, 15, 15, 15, 15, 15, 15, 15,
+     5,  5,  5,  5,  5,  5,  5,  5,
+     0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+static const int knightPsq[64] = {
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50,
+};
+
+static const int bishopPsq[64] = {
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20,
+};
+
+static const int rookMg[64] = {
+     0,  0,  0,  0,  0,  0,  0,  0,
+     5, 10, 10, 10, 10, 10, 10,  5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+     0,  0,  0,  5,  5,  0,  0,  0,
+};
+
+static const int rookEg[64] = {
+     5,  5,  5,  5,  5,  5,  5,  5,
+    10, 10, 10, 10, 10, 10, 10, 10,
+     0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+static const int queenPsq[64] = {
+    -20, -10, -10, -5, -5, -10, -10, -20,
+    -10,   0,   0,  0,  0,   0,   0, -10,
+    -10,   0,   5,  5,  5,   5,   0, -10,
+     -5,   0,   5,  5,  5,   5,   0,  -5,
+      0,   0,   5,  5,  5,   5,   0,  -5,
+    -10,   5,   5,  5,  5,   5,   0, -10,
+    -10,   0,   5,  0,  0,   0,   0, -10,
+    -20, -10, -10, -5, -5, -10, -10, -20,
+};
+
+// Sheltered behind its pawns while the queens are on...
+static const int kingMg[64] = {
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+     20,  20,   0,   0,   0,   0,  20,  20,
+     20,  30,  10,   0,   0,  10,  30,  20,
+};
+
+// ...and in the centre once they are off
+static const int kingEg[64] = {
+    -50, -40, -30, -20, -20, -30, -40, -50,
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -30,   0,   0,   0,   0, -30, -30,
+    -50, -30, -30, -30, -30, -30, -30, -50,
+};
+
+const int *const psqBonus[2][6] = {
+    {pawnMg, knightPsq, bishopPsq, rookMg, queenPsq, kingMg},
+    {pawnEg, knightPsq, bishopPsq, rookEg, queenPsq, kingEg},
+};
+
+// ------------------ EVALUATION ------------------
+// Endgame credit per rank of a passed pawn for how much nearer the enemy
+// king is kept from its path than our own king
+#define PASSER_KING_DISTANCE 4
+
+static int passerKingTerms(const Position *pos, const PawnEntry *e) {
+    int score = 0;
+    for (int c = WHITE; c <= BLACK; c++) {
+        Bitboard b = e->passed[c];
+        int ourKing = lsb(pos->pieces[c][KING]), theirKing = lsb(pos->pieces[!c][KING]);
+        while (b) {
+            int sq = popLsb(&b);
+            int rank = c == WHITE ? squareRank(sq) : 7 - squareRank(sq);
+            int stop = c == WHITE ? sq + 8 : sq - 8;
+            if (rank < 3) continue;
+            int margin = squareDistance(theirKing, stop) - squareDistance(ourKing, stop);
+            int v = margin * (rank - 2) * PASSER_KING_DISTANCE;
+            score += c == WHITE ? v : -v;
+        }
+    }
+    return score;
+}
+
+// Blends the middlegame and endgame scores by how much material is left.
+// Material and piece-square terms are kept up to date by putPiece and
+// removePiece; pawn structure and the material terms come from 'pawns'
+// and 'material', the calling thread's caches, or are computed afresh
+// when NULL. A recognised ending is scored by its own evaluator instead.
+int evaluate(const Position *pos, PawnTable *pawns, MaterialTable *material) {
+    MaterialEntry localMaterial, *m = &localMaterial;
+    if (material) m = probeMaterial(pos, material);
+    else computeMaterial(pos, &localMaterial);
+    if (m->evaluate) {
+        int v = m->evaluate(pos, m->strongSide);
+        return pos->sideToMove == m->strongSide ? v : -v;
+    }
+
+    PawnEntry local, *e = &local;
+    if (pawns) e = probePawns(pos, pawns);
+    else evaluatePawns(pos, &local);
+
+    int mg = pos->psq[MG] + m->imbalance[MG] + e->score[MG] + kingShelter(e, pos, WHITE) - kingShelter(e, pos, BLACK);
+    int eg = pos->psq[EG] + m->imbalance[EG] + e->score[EG] + passerKingTerms(pos, e);
+    if (m->scale) eg = eg * m->scale(pos) / SCALE_NORMAL;
+    int score = (mg * m->phase + eg * (PHASE_MAX - m->phase)) / PHASE_MAX;
+    return pos->sideToMove == WHITE ? score : -score;
+}
@@ -0,0 +1,27 @@
+#ifndef EVALUATE_H
+#define EVALUATE_H
+
+#include "position.h"
+#include "pawns.h"
+#include "material.h"
+
+#define PHASE_MAX 24 // Game phase of the full set of pieces; bare kings and pawns are 0
+
+enum { MG, EG }; // Game stages the piece-square scores are kept for
+
+// Centipawn values indexed by piece type; the king is never traded
+extern const int pieceValue[6];
+extern const int stageValue[2][6];
+extern const int phaseWeight[6];
+extern const int *const psqBonus[2][6];
+
+// Material plus square bonus of one piece for one stage, positive for White
+static inline int psqScore(int stage, int color, int type, int sq) {
+    int v = stageValue[stage][type] + psqBonus[stage][type][color == WHITE ? sq ^ 56 : sq];
+    return color == WHITE ? v : -v;
+}
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+int evaluate(const Position *pos, PawnTable *pawns, MaterialTable *material);
+
+#endif
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+#include "book.h"
+#include "syzygy.h"
+
+void initGame(GameState *game, GameHistory *history) {
+    initPosition(&game->pos);
+    game->lastMove = MOVE_NONE;
+    game->pendingMove = MOVE_NONE;
+    game->promotionPending = 0;
+    game->gameOver = 'n';
+    history->count = 0;
+}
+
+// Plays a move and records it in the preallocated history
+int pushMove(GameState *game, GameHistory *history, Move move) {
+    if (history->count == MAX_GAME_PLY) return 0;
+    makeMove(&game->pos, move, &history->states[history->count]);
+    history->moves[history->count++] = move;
+    game->lastMove = move;
+    return 1;
+}
+
+void undoMove(GameState *game, GameHistory *history) {
+    if (history->count == 0) return;
+
+    history->count--;
+    unmakeMove(&game->pos, history->moves[history->count], &history->states[history->count]);
+    game->lastMove = history->count ? history->moves[history->count - 1] : MOVE_NONE;
+    game->gameOver = 'n'; // Reset game over state on undo
+}
+
+// Looks the move up among the legal moves of the side to move. For a
+// promotion the queen promotion is returned.
+int isMoveValid(const GameState *game, int fromRow, int fromCol, int toRow, int toCol, Move *move) {
+    if (toRow < 0 || toRow >= 8 || toCol < 0 || toCol >= 8) return 0;
+
+    int from = makeSquare(fromRow, fromCol);
+    int to = makeSquare(toRow, toCol);
+    Move moves[MAX_MOVES];
+    int count = generateLegalMoves(&game->pos, moves);
+    for (int i = 0; i < count; i++) {
+        if (moveFrom(moves[i]) == from && moveTo(moves[i]) == to) {
+            *move = moves[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int isKingInCheck(const GameState *game, char color) {
+    return isInCheck(&game->pos, colorIndex(color));
+}
+
+// Checkmate test for the side to move
+int isCheckmate(GameState *game) {
+    int us = game->pos.sideToMove;
+    if (!isInCheck(&game->pos, us)) return 0;
+
+    Move moves[MAX_MOVES];
+    if (generateLegalMoves(&game->pos, moves) > 0) return 0;
+    game->gameOver = colorChar(!us); // Set winner
+    return 1;
+}
+
+// Ends the game early once the tablebases show a forced win for one side
+// that the fifty-move rule cannot stop. Without tables loaded, never does.
+int isTablebaseWin(GameState *game) {
+    Position pos = game->pos; // Probing makes and unmakes moves
+    int found, dtz = syzygyProbeDtz(&pos, &found);
+    if (!found || dtz == 0 || abs(dtz) + pos.halfmoveClock >= 100) return 0;
+    game->gameOver = colorChar(dtz > 0 ? pos.sideToMove : !pos.sideToMove);
+    return 1;
+}
+
+// Searches for the side to move, with the game so far counted for repetitions.
+// Positions the tablebases cover are answered from them without a search.
+Move computerMove(SearchPool *pool, const GameState *game, const GameHistory *history,
+                  const SearchLimits *limits, SearchResult *result) {
+    Position pos = game->pos;
+    Move move = bookProbe(&pos);
+    if (move != MOVE_NONE) {
+        memset(result, 0, sizeof(*result));
+        result->bestMove = result->pv[0] = move;
+        result->pvLength = 1;
+        return move;
+    }
+
+    int wdl, dtz;
+    Move tbMove = syzygyProbeRoot(&pos, &wdl, &dtz);
+    if (tbMove != MOVE_NONE) {
+        memset(result, 0, sizeof(*result));
+        result->bestMove = result->pv[0] = tbMove;
+        result->pvLength = 1;
+        result->score = wdl == TB_WIN ? TB_WIN_SCORE : wdl == TB_LOSS ? -TB_WIN_SCORE : 0;
+        result->tbHits = 1;
+        return tbMove;
+    }
+
+    uint64_t keys[MAX_REPETITION_KEYS];
+    int count = history->count < MAX_REPETITION_KEYS ? history->count : MAX_REPETITION_KEYS;
+    for (int i = 0; i < count; i++) keys[i] = history->states[history->count - count + i].key;
+    searchPosition(pool, &game->pos, keys, count, limits, result);
+    return result->bestMove;
+}
@@ -0,0 +1,39 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "search.h"
+
+#define MAX_GAME_PLY 1024 // Longest game a history can record
+
+// ------------------ STRUCT DEFINITIONS ------------------
+// Everything the rules need to know about one game in progress. It holds no
+// pointers, so a copy is an independent game and any number of them can live
+// side by side in one process.
+typedef struct {
+    _Alignas(64) Position pos;
+    Move lastMove;         // Most recent move played, or MOVE_NONE
+    Move pendingMove;      // Pawn move waiting for the promotion choice
+    char promotionPending; // Set while pendingMove awaits a piece
+    char gameOver;         // 'n' = no winner, 'w' = white wins, 'b' = black wins
+} GameState;
+
+// Played moves and the state each one overwrote, oldest first. Kept apart
+// from GameState so copying a game does not drag its whole past along.
+typedef struct {
+    Move moves[MAX_GAME_PLY];
+    StateInfo states[MAX_GAME_PLY];
+    int count;
+} GameHistory;
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+void initGame(GameState *game, GameHistory *history);
+int pushMove(GameState *game, GameHistory *history, Move move);
+void undoMove(GameState *game, GameHistory *history);
+int isMoveValid(const GameState *game, int fromRow, int fromCol, int toRow, int toCol, Move *move);
+int isKingInCheck(const GameState *game, char color);
+int isCheckmate(GameState *game);
+int isTablebaseWin(GameState *game);
+Move computerMove(SearchPool *pool, const GameState *game, const GameHistory *history,
+                  const SearchLimits *limits, SearchResult *result);
+
+#endif
@@ -0,0 +1,92 @@
+// Finds magic multipliers for the sliding-piece tables and prints them as C
+// source: gcc -O2 genmagics.c -o genmagics && ./genmagics > magics.h
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint64_t Bitboard;
+
+static const int rookDirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+static const int bishopDirs[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+// xorshift64*, fixed seed so the output is reproducible
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rand64(void) {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 2685821657736338717ULL;
+}
+
+static Bitboard slidingAttacks(int sq, Bitboard occupied, const int dirs[4][2]) {
+    Bitboard attacks = 0;
+    for (int d = 0; d < 4; d++) {
+        int r = (sq >> 3) + dirs[d][0], c = (sq & 7) + dirs[d][1];
+        while (r >= 0 && r < 8 && c >= 0 && c < 8) {
+            Bitboard bb = 1ULL << (r * 8 + c);
+            attacks |= bb;
+            if (occupied & bb) break;
+            r += dirs[d][0];
+            c += dirs[d][1];
+        }
+    }
+    return attacks;
+}
+
+// Relevant occupancy: the attack set on an empty board minus the edge squares
+// that cannot block anything further along the ray
+static Bitboard relevantMask(int sq, const int dirs[4][2]) {
+    Bitboard rankEdges = 0xFF000000000000FFULL & ~(0xFFULL << ((sq >> 3) * 8));
+    Bitboard fileEdges = 0x8181818181818181ULL & ~(0x0101010101010101ULL << (sq & 7));
+    return slidingAttacks(sq, 0, dirs) & ~(rankEdges | fileEdges);
+}
+
+static Bitboard findMagic(int sq, const int dirs[4][2]) {
+    static Bitboard occupancies[4096], reference[4096], used[4096];
+    Bitboard mask = relevantMask(sq, dirs);
+    int bits = __builtin_popcountll(mask);
+    int size = 0;
+
+    // Carry-rippler enumeration of every subset of the mask
+    Bitboard b = 0;
+    do {
+        occupancies[size] = b;
+        reference[size] = slidingAttacks(sq, b, dirs);
+        size++;
+        b = (b - mask) & mask;
+    } while (b);
+
+    for (;;) {
+        Bitboard magic = rand64() & rand64() & rand64();
+        if (__builtin_popcountll((mask * magic) >> 56) < 6) continue;
+
+        memset(used, 0, sizeof(Bitboard) * (size_t)size);
+        int ok = 1;
+        for (int i = 0; i < size && ok; i++) {
+            unsigned idx = (unsigned)((occupancies[i] * magic) >> (64 - bits));
+            if (!used[idx]) used[idx] = reference[i];
+            else if (used[idx] != reference[i]) ok = 0;
+        }
+        if (ok) return magic;
+    }
+}
+
+static void printTable(const char *name, const int dirs[4][2]) {
+    printf("static const Bitboard %s[64] = {\n", name);
+    for (int sq = 0; sq < 64; sq++) {
+        printf("%s0x%016llXULL,%s", sq % 4 == 0 ? "    " : " ",
+               (unsigned long long)findMagic(sq, dirs), sq % 4 == 3 ? "\n" : "");
+    }
+    printf("};\n");
+}
+
+int main(void) {
+    printf("// Generated by genmagics.c, do not edit\n");
+    printf("#ifndef MAGICS_H\n#define MAGICS_H\n\n");
+    printTable("rookMagicNumbers", rookDirs);
+    printf("\n");
+    printTable("bishopMagicNumbers", bishopDirs);
+    printf("\n#endif\n");
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stddef.h>
+
+// ------------------ READ-ONLY FILE MAPPING ------------------
+// Maps a whole file into memory so large read-only data (network weights,
+// tablebases, game collections) is paged in on demand and shared between
+// processes instead of being copied into the heap
+typedef struct {
+    const unsigned char *data; // NULL when nothing is mapped
+    size_t size;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#endif
+} MappedFile;
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+int mapFile(MappedFile *mf, const char *path);
+void unmapFile(MappedFile *mf);
+
+#endif
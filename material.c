@@ -0,0 +1,91 @@
+#include <stddef.h>
+#include "material.h"
+#include "evaluate.h"
+
+#define BISHOP_PAIR_MG 30
+#define BISHOP_PAIR_EG 50
+#define KNIGHT_PER_PAWN 6  // Knights gain with each own pawn past five...
+#define ROOK_PER_PAWN 12   // ...rooks lose, wanting open files
+
+static int count(const Position *pos, int color, int type) {
+    return popCount(pos->pieces[color][type]);
+}
+
+// Material of 'color' besides pawns and king
+static int nonPawnMaterial(const Position *pos, int color) {
+    return pos->material[color] - count(pos, color, PAWN) * pieceValue[PAWN];
+}
+
+// Picks the specialised code for the ending, if one applies
+static void recogniseEndgame(const Position *pos, MaterialEntry *e) {
+    for (int c = WHITE; c <= BLACK; c++) {
+        if (pos->material[!c]) continue; // Only against a bare king
+        int npm = nonPawnMaterial(pos, c), pawns = count(pos, c, PAWN);
+        e->strongSide = (uint8_t)c;
+        if (!pawns && count(pos, c, BISHOP) == 1 && npm == pieceValue[BISHOP] + pieceValue[KNIGHT]) {
+            e->evaluate = evaluateKBNK;
+        } else if (!npm && pawns == 1) {
+            e->evaluate = evaluateKPK;
+        } else if (!pawns && (npm <= pieceValue[BISHOP] || npm == 2 * pieceValue[KNIGHT])) {
+            e->evaluate = evaluateDraw; // A minor, or two knights, cannot force mate
+        } else if (npm >= pieceValue[ROOK]) {
+            e->evaluate = evaluateKXK;
+        }
+        if (e->evaluate) return;
+    }
+
+    // No pawns and at most one minor each: nobody can mate
+    int pieces = 0;
+    for (int c = WHITE; c <= BLACK; c++) {
+        int minors = count(pos, c, KNIGHT) + count(pos, c, BISHOP);
+        pieces += count(pos, c, PAWN) + count(pos, c, ROOK) + count(pos, c, QUEEN) + (minors > 1);
+    }
+    if (!pieces) {
+        e->evaluate = evaluateDraw;
+        return;
+    }
+
+    // A bishop each and pawns: whether the bishops share a colour is not
+    // part of the material, so the scale function checks at each call
+    if (count(pos, WHITE, BISHOP) == 1 && count(pos, BLACK, BISHOP) == 1 &&
+        nonPawnMaterial(pos, WHITE) == pieceValue[BISHOP] && nonPawnMaterial(pos, BLACK) == pieceValue[BISHOP]) {
+        e->scale = scaleOppositeBishops;
+    }
+}
+
+// Full computation of the material terms, written into 'e'
+void computeMaterial(const Position *pos, MaterialEntry *e) {
+    int imbalance[2] = {0, 0};
+    for (int c = WHITE; c <= BLACK; c++) {
+        int sign = c == WHITE ? 1 : -1;
+        int pawns = count(pos, c, PAWN) - 5;
+        if (count(pos, c, BISHOP) >= 2) {
+            imbalance[MG] += sign * BISHOP_PAIR_MG;
+            imbalance[EG] += sign * BISHOP_PAIR_EG;
+        }
+        int v = count(pos, c, KNIGHT) * pawns * KNIGHT_PER_PAWN - count(pos, c, ROOK) * pawns * ROOK_PER_PAWN;
+        imbalance[MG] += sign * v;
+        imbalance[EG] += sign * v;
+    }
+    e->key = pos->materialKey;
+    e->imbalance[MG] = (int16_t)imbalance[MG];
+    e->imbalance[EG] = (int16_t)imbalance[EG];
+    e->phase = (uint8_t)(pos->phase < PHASE_MAX ? pos->phase : PHASE_MAX);
+    e->evaluate = NULL;
+    e->scale = NULL;
+    e->strongSide = WHITE;
+    recogniseEndgame(pos, e);
+}
+
+// The entry for the current piece counts, computed on a miss. Unused
+// entries have key 0, which no position's material key takes in practice.
+MaterialEntry *probeMaterial(const Position *pos, MaterialTable *table) {
+    MaterialEntry *e = &table->entries[pos->materialKey & (MATERIAL_TABLE_SIZE - 1)];
+    table->probes++;
+    if (e->key == pos->materialKey) {
+        table->hits++;
+        return e;
+    }
+    computeMaterial(pos, e);
+    return e;
+}
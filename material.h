@@ -0,0 +1,31 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "position.h"
+#include "endgame.h"
+
+// ------------------ MATERIAL TABLE ------------------
+// Everything that depends on the piece counts alone, cached per search
+// thread by the position's material key: the imbalance terms, the game
+// phase and which specialised endgame code, if any, applies.
+#define MATERIAL_TABLE_SIZE 8192 // Entries per thread, a power of two
+
+typedef struct {
+    uint64_t key;
+    EndgameEval evaluate;  // Replaces the evaluation when set...
+    EndgameScale scale;    // ...else, when set, scales its endgame part
+    int16_t imbalance[2];  // [MG] and [EG], White minus Black
+    uint8_t phase;         // Game phase, capped at PHASE_MAX
+    uint8_t strongSide;    // Side 'evaluate' scores for
+} MaterialEntry;
+
+typedef struct {
+    MaterialEntry entries[MATERIAL_TABLE_SIZE];
+    uint64_t probes, hits; // Owner thread's lookups since the last reset
+} MaterialTable;
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+void computeMaterial(const Position *pos, MaterialEntry *e);
+MaterialEntry *probeMaterial(const Position *pos, MaterialTable *table);
+
+#endif
@@ -0,0 +1,348 @@
+#include "movegen.h"
+
+static Move *addMove(Move *moves, int from, int to, int flag) {
+    *moves++ = encodeMove(from, to, flag, KNIGHT);
+    return moves;
+}
+
+static Move *addPromotions(Move *moves, int from, int to) {
+    for (int type = QUEEN; type >= KNIGHT; type--) {
+        *moves++ = encodeMove(from, to, MOVE_PROMOTION, type);
+    }
+    return moves;
+}
+
+static Bitboard attacksFrom(int type, int sq, Bitboard occupied) {
+    switch (type) {
+        case KNIGHT: return knightAttacks[sq];
+        case BISHOP: return bishopAttacks(sq, occupied);
+        case ROOK:   return rookAttacks(sq, occupied);
+        case QUEEN:  return queenAttacks(sq, occupied);
+        case KING:   return kingAttacks[sq];
+    }
+    return 0;
+}
+
+int isSquareAttacked(const Position *pos, int sq, int byColor, Bitboard occupied) {
+    const Bitboard *them = pos->pieces[byColor];
+    if (pawnAttacks[!byColor][sq] & them[PAWN]) return 1;
+    if (knightAttacks[sq] & them[KNIGHT]) return 1;
+    if (kingAttacks[sq] & them[KING]) return 1;
+    if (bishopAttacks(sq, occupied) & (them[BISHOP] | them[QUEEN])) return 1;
+    if (rookAttacks(sq, occupied) & (them[ROOK] | them[QUEEN])) return 1;
+    return 0;
+}
+
+// Pieces of both colors attacking 'sq' when only 'occupied' blocks sliders
+Bitboard attackersTo(const Position *pos, int sq, Bitboard occupied) {
+    Bitboard bishops = pos->pieces[WHITE][BISHOP] | pos->pieces[BLACK][BISHOP];
+    Bitboard rooks = pos->pieces[WHITE][ROOK] | pos->pieces[BLACK][ROOK];
+    Bitboard queens = pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+    return (pawnAttacks[BLACK][sq] & pos->pieces[WHITE][PAWN])
+         | (pawnAttacks[WHITE][sq] & pos->pieces[BLACK][PAWN])
+         | (knightAttacks[sq] & (pos->pieces[WHITE][KNIGHT] | pos->pieces[BLACK][KNIGHT]))
+         | (kingAttacks[sq] & (pos->pieces[WHITE][KING] | pos->pieces[BLACK][KING]))
+         | (bishopAttacks(sq, occupied) & (bishops | queens))
+         | (rookAttacks(sq, occupied) & (rooks | queens));
+}
+
+int isInCheck(const Position *pos, int color) {
+    Bitboard king = pos->pieces[color][KING];
+    return king && isSquareAttacked(pos, lsb(king), !color, pos->occupied);
+}
+
+// Whether a legal move checks the opponent, worked out from the board as it
+// stands so a search can decide on a move without making it: the moved piece
+// (or the castling rook) hits the king from its new square, or a slider of
+// ours behind the vacated squares now sees it
+int givesCheck(const Position *pos, Move move) {
+    int us = pos->sideToMove;
+    Bitboard king = pos->pieces[!us][KING];
+    if (!king) return 0;
+    int ksq = lsb(king);
+    int from = moveFrom(move), to = moveTo(move), flag = moveFlag(move);
+    int type = flag == MOVE_PROMOTION ? movePromotion(move) : pieceTypeOn(pos, from);
+    Bitboard occupied = (pos->occupied & ~SQUARE_BB(from)) | SQUARE_BB(to);
+    Bitboard moved = SQUARE_BB(from);
+
+    if (flag == MOVE_EN_PASSANT) occupied &= ~SQUARE_BB(to - (us == WHITE ? 8 : -8));
+    if (flag == MOVE_CASTLING) {
+        int rookFrom, rookTo;
+        castlingRookSquares(move, &rookFrom, &rookTo);
+        occupied = (occupied & ~SQUARE_BB(rookFrom)) | SQUARE_BB(rookTo);
+        moved |= SQUARE_BB(rookFrom);
+        if (rookAttacks(rookTo, occupied) & king) return 1;
+    }
+
+    if ((type == PAWN ? pawnAttacks[us][to] : attacksFrom(type, to, occupied)) & king) return 1;
+
+    const Bitboard *ours = pos->pieces[us];
+    Bitboard diagonal = (ours[BISHOP] | ours[QUEEN]) & ~moved;
+    Bitboard straight = (ours[ROOK] | ours[QUEEN]) & ~moved;
+    return (bishopAttacks(ksq, occupied) & diagonal) || (rookAttacks(ksq, occupied) & straight);
+}
+
+// Enemy pieces giving check to the king on 'ksq'
+static Bitboard checkersTo(const Position *pos, int ksq, int us) {
+    const Bitboard *them = pos->pieces[!us];
+    return (pawnAttacks[us][ksq] & them[PAWN])
+         | (knightAttacks[ksq] & them[KNIGHT])
+         | (bishopAttacks(ksq, pos->occupied) & (them[BISHOP] | them[QUEEN]))
+         | (rookAttacks(ksq, pos->occupied) & (them[ROOK] | them[QUEEN]));
+}
+
+// Own pieces that are the only blocker between the king and an enemy slider
+static Bitboard pinnedPieces(const Position *pos, int ksq, int us) {
+    const Bitboard *them = pos->pieces[!us];
+    Bitboard pinned = 0;
+    Bitboard snipers = (rookAttacks(ksq, 0) & (them[ROOK] | them[QUEEN]))
+                     | (bishopAttacks(ksq, 0) & (them[BISHOP] | them[QUEEN]));
+    while (snipers) {
+        Bitboard blockers = betweenBB[ksq][popLsb(&snipers)] & pos->occupied;
+        if (blockers && !(blockers & (blockers - 1))) pinned |= blockers & pos->byColor[us];
+    }
+    return pinned;
+}
+
+// Which moves a generator call writes. Captures include en passant and every
+// promotion; quiets are the rest, castling included.
+enum { GEN_ALL, GEN_CAPTURES, GEN_QUIETS };
+
+// Shared generator body. With 'legal' set, checkers and pinned pieces are
+// computed once and only moves that keep the king safe are written.
+static int generate(const Position *pos, Move *moves, int legal, int stage) {
+    Move *m = moves;
+    int us = pos->sideToMove, them = !us;
+    Bitboard own = pos->byColor[us];
+    Bitboard enemy = pos->byColor[them];
+    Bitboard empty = ~pos->occupied;
+    int up = (us == WHITE) ? 8 : -8;
+    Bitboard startRank = (us == WHITE) ? RANK_2_BB : RANK_7_BB;
+    Bitboard lastRank = (us == WHITE) ? RANK_8_BB : RANK_1_BB;
+    int ksq = lsb(pos->pieces[us][KING]);
+    int tactical = stage != GEN_QUIETS, quiet = stage != GEN_CAPTURES;
+    Bitboard stageMask = stage == GEN_CAPTURES ? enemy : stage == GEN_QUIETS ? empty : ~own;
+
+    // Squares non-king moves may land on, and pieces restricted to their pin line
+    Bitboard checkMask = ~0ULL;
+    Bitboard pinned = 0;
+    Bitboard checkers = 0;
+    if (legal) {
+        checkers = checkersTo(pos, ksq, us);
+        pinned = pinnedPieces(pos, ksq, us);
+        if (checkers) {
+            int checker = lsb(checkers);
+            checkMask = betweenBB[ksq][checker] | checkers;
+        }
+    }
+    Bitboard targetMask = stageMask & checkMask;
+
+    // King steps; only these can answer a double check
+    Bitboard kingTargets = kingAttacks[ksq] & stageMask;
+    while (kingTargets) {
+        int to = popLsb(&kingTargets);
+        if (legal && isSquareAttacked(pos, to, them, pos->occupied ^ SQUARE_BB(ksq))) continue;
+        m = addMove(m, ksq, to, MOVE_NORMAL);
+    }
+    if (checkers & (checkers - 1)) return (int)(m - moves);
+
+    // Pawns; promotions by push count as tactical, so the stage is tested per
+    // move here rather than through the target mask
+    Bitboard pawns = pos->pieces[us][PAWN];
+    while (pawns) {
+        int from = popLsb(&pawns);
+        Bitboard allowed = checkMask;
+        if (pinned & SQUARE_BB(from)) allowed &= lineBB[ksq][from];
+
+        int to = from + up;
+        if (empty & SQUARE_BB(to)) {
+            if (allowed & SQUARE_BB(to)) {
+                if (lastRank & SQUARE_BB(to)) {
+                    if (tactical) m = addPromotions(m, from, to);
+                } else if (quiet) {
+                    m = addMove(m, from, to, MOVE_NORMAL);
+                }
+            }
+            if (quiet && (startRank & SQUARE_BB(from)) && (empty & allowed & SQUARE_BB(to + up))) {
+                m = addMove(m, from, to + up, MOVE_NORMAL);
+            }
+        }
+        if (!tactical) continue;
+        Bitboard captures = pawnAttacks[us][from] & enemy & allowed;
+        while (captures) {
+            to = popLsb(&captures);
+            if (lastRank & SQUARE_BB(to)) m = addPromotions(m, from, to);
+            else m = addMove(m, from, to, MOVE_NORMAL);
+        }
+        if (pos->epSquare != NO_SQUARE && (pawnAttacks[us][from] & SQUARE_BB(pos->epSquare))) {
+            Move ep = encodeMove(from, pos->epSquare, MOVE_EN_PASSANT, KNIGHT);
+            // Two pawns leave the rank at once, so test this rare case on a copy
+            if (legal) {
+                Position next = *pos;
+                StateInfo st;
+                makeMove(&next, ep, &st);
+                if (isInCheck(&next, us)) continue;
+            }
+            *m++ = ep;
+        }
+    }
+
+    // Knights, bishops, rooks and queens
+    for (int type = KNIGHT; type <= QUEEN; type++) {
+        Bitboard pieces = pos->pieces[us][type];
+        while (pieces) {
+            int from = popLsb(&pieces);
+            Bitboard targets = attacksFrom(type, from, pos->occupied) & targetMask;
+            if (pinned & SQUARE_BB(from)) targets &= lineBB[ksq][from];
+            while (targets) m = addMove(m, from, popLsb(&targets), MOVE_NORMAL);
+        }
+    }
+
+    // Castling: right still held, empty path, no attacked square on the king's way.
+    // Holding a right implies king and rook are still on their home squares.
+    int rights = pos->castling & (us == WHITE ? WHITE_OO | WHITE_OOO : BLACK_OO | BLACK_OOO);
+    if (quiet && !checkers && rights && (legal || !isSquareAttacked(pos, ksq, them, pos->occupied))) {
+        while (rights) {
+            int kingSide = rights & (WHITE_OO | BLACK_OO);
+            rights &= ~(kingSide ? WHITE_OO | BLACK_OO : WHITE_OOO | BLACK_OOO);
+            int rookSq = kingSide ? ksq + 3 : ksq - 4;
+            int to = kingSide ? ksq + 2 : ksq - 2;
+            if (betweenBB[ksq][rookSq] & pos->occupied) continue;
+            int step = kingSide ? 1 : -1;
+            if (isSquareAttacked(pos, ksq + step, them, pos->occupied) ||
+                isSquareAttacked(pos, to, them, pos->occupied)) continue;
+            m = addMove(m, ksq, to, MOVE_CASTLING);
+        }
+    }
+
+    return (int)(m - moves);
+}
+
+// Writes every pseudo-legal move of the side to move into 'moves' (which must
+// hold MAX_MOVES entries) and returns the count. Moves may still leave the
+// king in check; castling already checks the squares the king crosses.
+int generateMoves(const Position *pos, Move *moves) {
+    return generate(pos, moves, 0, GEN_ALL);
+}
+
+// Same as generateMoves but only writes legal moves, evasions included
+int generateLegalMoves(const Position *pos, Move *moves) {
+    return generate(pos, moves, 1, GEN_ALL);
+}
+
+// The legal moves split in two, for searches that may stop before needing
+// the quiet ones: captures, en passant and promotions...
+int generateLegalCaptures(const Position *pos, Move *moves) {
+    return generate(pos, moves, 1, GEN_CAPTURES);
+}
+
+// ...and everything else
+int generateLegalQuiets(const Position *pos, Move *moves) {
+    return generate(pos, moves, 1, GEN_QUIETS);
+}
+
+// Whether 'move' is one the legal generator would produce here. Used to vet
+// moves that come from elsewhere (hash table, killers, opening books)
+// without generating the whole list.
+int isLegalMove(const Position *pos, Move move) {
+    int us = pos->sideToMove;
+    int from = moveFrom(move), to = moveTo(move), flag = moveFlag(move);
+    Piece piece = pos->board[from];
+    if (move == MOVE_NONE || piece == NO_PIECE || pieceColor(piece) != us) return 0;
+    if (pos->byColor[us] & SQUARE_BB(to)) return 0;
+    if (flag != MOVE_PROMOTION && movePromotion(move) != KNIGHT) return 0;
+
+    int type = pieceType(piece);
+    Bitboard lastRank = (us == WHITE) ? RANK_8_BB : RANK_1_BB;
+    if (flag == MOVE_CASTLING) {
+        // Rare enough to settle against the generator itself
+        Move moves[MAX_MOVES];
+        int count = generateLegalQuiets(pos, moves);
+        for (int i = 0; i < count; i++) {
+            if (moves[i] == move) return 1;
+        }
+        return 0;
+    }
+    if (flag == MOVE_EN_PASSANT) {
+        if (type != PAWN || to != pos->epSquare || !(pawnAttacks[us][from] & SQUARE_BB(to))) return 0;
+    } else if (type == PAWN) {
+        int up = (us == WHITE) ? 8 : -8;
+        Bitboard startRank = (us == WHITE) ? RANK_2_BB : RANK_7_BB;
+        if ((flag == MOVE_PROMOTION) != ((lastRank & SQUARE_BB(to)) != 0)) return 0;
+        int push = to == from + up && !(pos->occupied & SQUARE_BB(to));
+        int doublePush = to == from + 2 * up && (startRank & SQUARE_BB(from)) &&
+                         !(pos->occupied & (SQUARE_BB(from + up) | SQUARE_BB(to)));
+        int capture = (pawnAttacks[us][from] & pos->byColor[!us] & SQUARE_BB(to)) != 0;
+        if (!push && !doublePush && !capture) return 0;
+    } else {
+        if (flag != MOVE_NORMAL || !(attacksFrom(type, from, pos->occupied) & SQUARE_BB(to))) return 0;
+    }
+
+    // The move is pseudo-legal; it stands if our king is not left attacked
+    if (type == KING) return !isSquareAttacked(pos, to, !us, pos->occupied ^ SQUARE_BB(from));
+    Position next = *pos;
+    StateInfo st;
+    makeMove(&next, move, &st);
+    return !isInCheck(&next, us);
+}
+
+// Resolves a move in Standard Algebraic Notation ("Nbd7", "exd8=Q+",
+// "O-O") against the legal moves. Returns MOVE_NONE if it names no legal
+// move or more than one.
+Move parseSan(const Position *pos, const char *san, int length) {
+    while (length > 0 && (san[length - 1] == '+' || san[length - 1] == '#' || san[length - 1] == '!' ||
+                          san[length - 1] == '?'))
+        length--;
+    if (length < 2) return MOVE_NONE;
+    int us = pos->sideToMove;
+
+    if (san[0] == 'O' || san[0] == '0') {
+        int ksq = lsb(pos->pieces[us][KING]);
+        Move move = encodeMove(ksq, length >= 5 ? ksq - 2 : ksq + 2, MOVE_CASTLING, KNIGHT);
+        return (length == 3 || length == 5) && isLegalMove(pos, move) ? move : MOVE_NONE;
+    }
+
+    const char *p = san, *end = san + length;
+    int type = PAWN, promotion = -1, fromFile = -1, fromRank = -1;
+    if (*p == 'N' || *p == 'B' || *p == 'R' || *p == 'Q' || *p == 'K') type = typeIndex(*p++);
+    if (type == PAWN && end - p > 2 && (end[-1] == 'N' || end[-1] == 'B' || end[-1] == 'R' || end[-1] == 'Q')) {
+        promotion = typeIndex(*--end);
+        if (end[-1] == '=') end--;
+    }
+    if (end - p < 2 || end[-2] < 'a' || end[-2] > 'h' || end[-1] < '1' || end[-1] > '8') return MOVE_NONE;
+    int to = (end[-1] - '1') * 8 + (end[-2] - 'a');
+    for (; p < end - 2; p++) {
+        if (*p >= 'a' && *p <= 'h') fromFile = *p - 'a';
+        else if (*p >= '1' && *p <= '8') fromRank = *p - '1';
+        else if (*p != 'x' && *p != ':' && *p != '-') return MOVE_NONE;
+    }
+
+    Bitboard from;
+    if (type != PAWN) {
+        from = attacksFrom(type, to, pos->occupied);
+    } else if (fromFile >= 0 && fromFile != squareCol(to)) {
+        from = pawnAttacks[!us][to];
+    } else {
+        int up = us == WHITE ? 8 : -8;
+        from = (to - up >= 0 && to - up < 64 ? SQUARE_BB(to - up) : 0) |
+               (to - 2 * up >= 0 && to - 2 * up < 64 ? SQUARE_BB(to - 2 * up) : 0);
+    }
+    from &= pos->pieces[us][type];
+    if (fromFile >= 0) from &= fileBB(fromFile);
+    if (fromRank >= 0) from &= RANK_1_BB << (8 * fromRank);
+
+    Bitboard lastRank = us == WHITE ? RANK_8_BB : RANK_1_BB;
+    Move found = MOVE_NONE;
+    while (from) {
+        int sq = popLsb(&from);
+        int flag = MOVE_NORMAL;
+        if (type == PAWN && to == pos->epSquare) flag = MOVE_EN_PASSANT;
+        else if (type == PAWN && (lastRank & SQUARE_BB(to))) flag = MOVE_PROMOTION;
+        if ((flag == MOVE_PROMOTION) != (promotion >= 0)) return MOVE_NONE;
+        Move move = encodeMove(sq, to, flag, flag == MOVE_PROMOTION ? promotion : KNIGHT);
+        if (!isLegalMove(pos, move)) continue;
+        if (found != MOVE_NONE) return MOVE_NONE;
+        found = move;
+    }
+    return found;
+}
@@ -0,0 +1,20 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "position.h"
+
+#define MAX_MOVES 256 // Upper bound on the moves of any reachable position
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+int generateMoves(const Position *pos, Move *moves);
+int generateLegalMoves(const Position *pos, Move *moves);
+int generateLegalCaptures(const Position *pos, Move *moves);
+int generateLegalQuiets(const Position *pos, Move *moves);
+int isLegalMove(const Position *pos, Move move);
+int isSquareAttacked(const Position *pos, int sq, int byColor, Bitboard occupied);
+Bitboard attackersTo(const Position *pos, int sq, Bitboard occupied);
+int isInCheck(const Position *pos, int color);
+int givesCheck(const Position *pos, Move move);
+Move parseSan(const Position *pos, const char *san, int length);
+
+#endif
@@ -0,0 +1,179 @@
+#include <stddef.h>
+#include "movepick.h"
+#include "evaluate.h"
+
+void initMovePicker(MovePicker *mp, const Position *pos, Move ttMove, const Move killers[2],
+                    const HistoryTable *history) {
+    mp->pos = pos;
+    mp->history = history;
+    mp->ttMove = isLegalMove(pos, ttMove) ? ttMove : MOVE_NONE;
+    mp->killers[0] = killers ? killers[0] : MOVE_NONE;
+    mp->killers[1] = killers ? killers[1] : MOVE_NONE;
+    mp->count = mp->index = mp->badCount = 0;
+    mp->capturesOnly = 0;
+    mp->stage = mp->ttMove != MOVE_NONE ? STAGE_TT : STAGE_GEN_CAPTURES;
+}
+
+// Captures and promotions that do not lose material only, for quiescence.
+// A hash move that is quiet is dropped.
+void initQuiescencePicker(MovePicker *mp, const Position *pos, Move ttMove) {
+    if (ttMove != MOVE_NONE && !isCapture(pos, ttMove) && moveFlag(ttMove) != MOVE_PROMOTION) ttMove = MOVE_NONE;
+    initMovePicker(mp, pos, ttMove, NULL, NULL);
+    mp->capturesOnly = 1;
+}
+
+int isCapture(const Position *pos, Move move) {
+    return pos->board[moveTo(move)] != NO_PIECE || moveFlag(move) == MOVE_EN_PASSANT;
+}
+
+// Most valuable victim first, least valuable attacker breaking ties; a
+// promotion counts its new piece as the victim
+static int mvvLva(const Position *pos, Move move) {
+    int victim = moveFlag(move) == MOVE_EN_PASSANT ? PAWN : pieceTypeOn(pos, moveTo(move));
+    int score = victim >= 0 ? pieceValue[victim] * 8 : 0;
+    if (moveFlag(move) == MOVE_PROMOTION) score += (pieceValue[movePromotion(move)] - pieceValue[PAWN]) * 8;
+    return score - pieceTypeOn(pos, moveFrom(move));
+}
+
+// ------------------ STATIC EXCHANGE EVALUATION ------------------
+// Whether the exchange 'move' starts on its target square gains at least
+// 'threshold' centipawns, both sides always recapturing with their least
+// valuable attacker and free to stop when that loses. Works on attack sets
+// alone, no make/unmake. Pins are ignored.
+int seeGe(const Position *pos, Move move, int threshold) {
+    if (moveFlag(move) != MOVE_NORMAL) return 0 >= threshold;
+
+    int from = moveFrom(move), to = moveTo(move);
+    int victim = pieceTypeOn(pos, to);
+    int swap = (victim >= 0 ? pieceValue[victim] : 0) - threshold;
+    if (swap < 0) return 0;
+    swap = pieceValue[pieceTypeOn(pos, from)] - swap;
+    if (swap <= 0) return 1;
+
+    Bitboard occupied = pos->occupied ^ SQUARE_BB(from) ^ SQUARE_BB(to);
+    Bitboard attackers = attackersTo(pos, to, occupied);
+    Bitboard diagonal = pos->pieces[WHITE][BISHOP] | pos->pieces[BLACK][BISHOP] |
+                        pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+    Bitboard straight = pos->pieces[WHITE][ROOK] | pos->pieces[BLACK][ROOK] |
+                        pos->pieces[WHITE][QUEEN] | pos->pieces[BLACK][QUEEN];
+    int stm = pos->sideToMove;
+    int result = 1;
+
+    for (;;) {
+        stm = !stm;
+        attackers &= occupied;
+        Bitboard ours = attackers & pos->byColor[stm];
+        if (!ours) break;
+        result ^= 1;
+
+        int type = PAWN;
+        while (type < KING && !(ours & pos->pieces[stm][type])) type++;
+        if (type == KING) {
+            // The king may only take last, when nothing can take it back
+            return (attackers & pos->byColor[!stm]) ? result ^ 1 : result;
+        }
+        swap = pieceValue[type] - swap;
+        if (swap < result) break;
+
+        // Removing the capturer can open a slider behind it
+        Bitboard piece = ours & pos->pieces[stm][type];
+        occupied ^= piece & -piece;
+        if (type == PAWN || type == BISHOP || type == QUEEN) attackers |= bishopAttacks(to, occupied) & diagonal;
+        if (type == ROOK || type == QUEEN) attackers |= rookAttacks(to, occupied) & straight;
+    }
+    return result;
+}
+
+// Selection step: swaps the best remaining move to the front and returns it.
+// Cheaper than a full sort when a cutoff comes after the first few moves.
+static Move pickBest(MovePicker *mp) {
+    int best = mp->index;
+    for (int i = mp->index + 1; i < mp->count; i++) {
+        if (mp->scores[i] > mp->scores[best]) best = i;
+    }
+    Move move = mp->moves[best];
+    int score = mp->scores[best];
+    mp->moves[best] = mp->moves[mp->index];
+    mp->scores[best] = mp->scores[mp->index];
+    mp->moves[mp->index] = move;
+    mp->scores[mp->index] = score;
+    mp->index++;
+    return move;
+}
+
+// Returns the next move to search, or MOVE_NONE once every legal move has
+// been handed out. Each legal move comes out exactly once.
+Move nextMove(MovePicker *mp) {
+    const Position *pos = mp->pos;
+    switch (mp->stage) {
+        case STAGE_TT:
+            mp->stage = STAGE_GEN_CAPTURES;
+            return mp->ttMove;
+
+        case STAGE_GEN_CAPTURES:
+            mp->count = generateLegalCaptures(pos, mp->moves);
+            mp->index = 0;
+            for (int i = 0; i < mp->count; i++) mp->scores[i] = mvvLva(pos, mp->moves[i]);
+            mp->stage = STAGE_CAPTURES;
+            /* fall through */
+        case STAGE_CAPTURES:
+            while (mp->index < mp->count) {
+                Move move = pickBest(mp);
+                if (move == mp->ttMove) continue;
+                if (seeGe(pos, move, 0)) return move;
+                // Slots before 'index' are spent, so losing captures can
+                // be parked there until the end
+                mp->moves[mp->badCount++] = move;
+            }
+            if (mp->capturesOnly) {
+                mp->stage = STAGE_DONE;
+                return MOVE_NONE;
+            }
+            mp->stage = STAGE_KILLERS;
+            mp->index = 0;
+            /* fall through */
+        case STAGE_KILLERS:
+            // Quiet moves that cut off at this ply in a sibling node
+            while (mp->index < 2) {
+                Move move = mp->killers[mp->index++];
+                if (move != MOVE_NONE && move != mp->ttMove && moveFlag(move) != MOVE_PROMOTION &&
+                    !isCapture(pos, move) && isLegalMove(pos, move)) return move;
+            }
+            mp->stage = STAGE_GEN_QUIETS;
+            /* fall through */
+        case STAGE_GEN_QUIETS: {
+            mp->count = mp->badCount + generateLegalQuiets(pos, mp->moves + mp->badCount);
+            mp->index = mp->badCount;
+            const int16_t (*history)[64] = (*mp->history)[pos->sideToMove];
+            for (int i = mp->index; i < mp->count; i++) {
+                mp->scores[i] = history[moveFrom(mp->moves[i])][moveTo(mp->moves[i])];
+            }
+            mp->stage = STAGE_QUIETS;
+        }
+            /* fall through */
+        case STAGE_QUIETS:
+            while (mp->index < mp->count) {
+                Move move = pickBest(mp);
+                if (move != mp->ttMove && move != mp->killers[0] && move != mp->killers[1]) return move;
+            }
+            mp->stage = STAGE_BAD_CAPTURES;
+            mp->index = 0;
+            /* fall through */
+        case STAGE_BAD_CAPTURES:
+            if (mp->index < mp->badCount) return mp->moves[mp->index++];
+            mp->stage = STAGE_DONE;
+            /* fall through */
+        case STAGE_DONE:
+        default:
+            return MOVE_NONE;
+    }
+}
+
+// Moves the entry towards +-HISTORY_MAX by 'bonus', less the further it
+// already is, so scores stay bounded and recent results weigh most
+void updateHistory(HistoryTable *history, int color, Move move, int bonus) {
+    int16_t *entry = &(*history)[color][moveFrom(move)][moveTo(move)];
+    if (bonus > HISTORY_MAX) bonus = HISTORY_MAX;
+    if (bonus < -HISTORY_MAX) bonus = -HISTORY_MAX;
+    *entry += (int16_t)(bonus - *entry * (bonus < 0 ? -bonus : bonus) / HISTORY_MAX);
+}
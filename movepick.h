@@ -0,0 +1,49 @@
+#ifndef MOVEPICK_H
+#define MOVEPICK_H
+
+#include "movegen.h"
+
+// ------------------ STAGED MOVE PICKER ------------------
+// Hands out the legal moves of a position best-first, one stage at a time,
+// so a node that cuts off early never generates or sorts the quiet moves:
+// hash move, winning and even captures by MVV-LVA, killer moves, quiet moves
+// by history, and last the captures that lose material by SEE. The
+// quiescence picker stops after the good captures.
+enum {
+    STAGE_TT,
+    STAGE_GEN_CAPTURES,
+    STAGE_CAPTURES,
+    STAGE_KILLERS,
+    STAGE_GEN_QUIETS,
+    STAGE_QUIETS,
+    STAGE_BAD_CAPTURES,
+    STAGE_DONE,
+};
+
+#define HISTORY_MAX 16384 // History scores stay within +-HISTORY_MAX
+
+typedef int16_t HistoryTable[2][64][64]; // [color][from][to]
+
+typedef struct {
+    const Position *pos;
+    const HistoryTable *history;
+    Move ttMove;
+    Move killers[2];
+    Move moves[MAX_MOVES]; // Losing captures are parked at the front
+    int scores[MAX_MOVES];
+    int count, index;
+    int badCount;
+    int stage;
+    int capturesOnly;
+} MovePicker;
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+void initMovePicker(MovePicker *mp, const Position *pos, Move ttMove, const Move killers[2],
+                    const HistoryTable *history);
+void initQuiescencePicker(MovePicker *mp, const Position *pos, Move ttMove);
+Move nextMove(MovePicker *mp);
+int isCapture(const Position *pos, Move move);
+int seeGe(const Position *pos, Move move, int threshold);
+void updateHistory(HistoryTable *history, int color, Move move, int bonus);
+
+#endif
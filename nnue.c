@@ -0,0 +1,347 @@
+#include <string.h>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+#ifdef DEBUG_POSITION
+#include <assert.h>
+#endif
+#include "nnue.h"
+#include "mapfile.h"
+
+#define NNUE_MAGIC "NNUEHKP1"
+#define NNUE_HEADER_SIZE 64
+#define NNUE_SHIFT 6          // Fixed-point bits of the int8 layer weights
+#define NNUE_SCALE 16         // Output units per centipawn
+#define NNUE_MAX_SCORE 20000  // Kept well clear of mate scores
+
+// ------------------ WEIGHTS ------------------
+// The file is a 64-byte header (magic, then the four layer sizes as
+// little-endian uint32) followed by each array in turn, every one starting
+// on a 64-byte boundary:
+//   int16 transformer biases[HIDDEN], weights[INPUTS][HIDDEN]
+//   int32 L1 biases[L1],  int8 weights[L1][2 * HIDDEN]
+//   int32 L2 biases[L2],  int8 weights[L2][L1]
+//   int32 output bias,    int8 weights[L2]
+// The arrays are used straight from the mapping, never copied.
+static MappedFile netFile;
+static const int16_t *ftBias, *ftWeights;
+static const int32_t *l1Bias, *l2Bias, *outBias;
+static const int8_t *l1Weights, *l2Weights, *outWeights;
+
+static size_t align64(size_t n) {
+    return (n + 63) & ~(size_t)63;
+}
+
+// Returns 0, leaving evaluation to evaluate(), if the file is missing or
+// not a network of this shape
+int nnueLoad(const char *path) {
+    nnueUnload();
+    if (!mapFile(&netFile, path)) return 0;
+    const unsigned char *base = netFile.data;
+    uint32_t dims[4];
+    if (netFile.size < NNUE_HEADER_SIZE || memcmp(base, NNUE_MAGIC, 8) != 0) {
+        unmapFile(&netFile);
+        return 0;
+    }
+    memcpy(dims, base + 8, sizeof(dims));
+    if (dims[0] != NNUE_INPUTS || dims[1] != NNUE_HIDDEN || dims[2] != NNUE_L1 || dims[3] != NNUE_L2) {
+        unmapFile(&netFile);
+        return 0;
+    }
+
+    size_t offsets[8], offset = NNUE_HEADER_SIZE;
+    const size_t sizes[8] = {
+        sizeof(int16_t) * NNUE_HIDDEN, sizeof(int16_t) * (size_t)NNUE_INPUTS * NNUE_HIDDEN,
+        sizeof(int32_t) * NNUE_L1,     sizeof(int8_t) * NNUE_L1 * 2 * NNUE_HIDDEN,
+        sizeof(int32_t) * NNUE_L2,     sizeof(int8_t) * NNUE_L2 * NNUE_L1,
+        sizeof(int32_t),               sizeof(int8_t) * NNUE_L2,
+    };
+    for (int i = 0; i < 8; i++) {
+        offsets[i] = offset;
+        offset = align64(offset + sizes[i]);
+    }
+    if (netFile.size < offset) {
+        unmapFile(&netFile);
+        return 0;
+    }
+    ftBias = (const int16_t *)(base + offsets[0]);
+    ftWeights = (const int16_t *)(base + offsets[1]);
+    l1Bias = (const int32_t *)(base + offsets[2]);
+    l1Weights = (const int8_t *)(base + offsets[3]);
+    l2Bias = (const int32_t *)(base + offsets[4]);
+    l2Weights = (const int8_t *)(base + offsets[5]);
+    outBias = (const int32_t *)(base + offsets[6]);
+    outWeights = (const int8_t *)(base + offsets[7]);
+    return 1;
+}
+
+void nnueUnload(void) {
+    unmapFile(&netFile);
+    ftBias = ftWeights = NULL;
+    l1Bias = l2Bias = outBias = NULL;
+    l1Weights = l2Weights = outWeights = NULL;
+}
+
+int nnueLoaded(void) {
+    return ftWeights != NULL;
+}
+
+// ------------------ FEATURE TRANSFORMER ------------------
+// Each side sees the board from its own end, so Black flips the ranks and
+// "own" pieces are always the first of each pair
+static int featureIndex(int perspective, int kingSq, Piece p, int sq) {
+    if (perspective == BLACK) {
+        kingSq ^= 56;
+        sq ^= 56;
+    }
+    int piece = pieceType(p) * 2 + (pieceColor(p) != perspective);
+    return (kingSq * 10 + piece) * 64 + sq;
+}
+
+// dst = src + the added rows - the removed rows; dst may be src
+static void updateRows(int16_t *dst, const int16_t *src, const int *added, int addCount, const int *removed,
+                       int removeCount) {
+#if defined(__AVX2__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        for (int k = 0; k < addCount; k++) {
+            const int16_t *row = ftWeights + (size_t)added[k] * NNUE_HIDDEN + i;
+            v = _mm256_add_epi16(v, _mm256_loadu_si256((const __m256i *)row));
+        }
+        for (int k = 0; k < removeCount; k++) {
+            const int16_t *row = ftWeights + (size_t)removed[k] * NNUE_HIDDEN + i;
+            v = _mm256_sub_epi16(v, _mm256_loadu_si256((const __m256i *)row));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+#elif defined(__SSE4_1__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        for (int k = 0; k < addCount; k++) {
+            const int16_t *row = ftWeights + (size_t)added[k] * NNUE_HIDDEN + i;
+            v = _mm_add_epi16(v, _mm_loadu_si128((const __m128i *)row));
+        }
+        for (int k = 0; k < removeCount; k++) {
+            const int16_t *row = ftWeights + (size_t)removed[k] * NNUE_HIDDEN + i;
+            v = _mm_sub_epi16(v, _mm_loadu_si128((const __m128i *)row));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        int v = src[i];
+        for (int k = 0; k < addCount; k++) v += ftWeights[(size_t)added[k] * NNUE_HIDDEN + i];
+        for (int k = 0; k < removeCount; k++) v -= ftWeights[(size_t)removed[k] * NNUE_HIDDEN + i];
+        dst[i] = (int16_t)v;
+    }
+#endif
+}
+
+// Sums one side's accumulator from scratch
+static void refresh(int16_t *values, const Position *pos, int perspective) {
+    int active[32], count = 0;
+    int kingSq = lsb(pos->pieces[perspective][KING]);
+    Bitboard b = pos->occupied & ~(pos->pieces[WHITE][KING] | pos->pieces[BLACK][KING]);
+    while (b) {
+        int sq = popLsb(&b);
+        active[count++] = featureIndex(perspective, kingSq, pos->board[sq], sq);
+    }
+    updateRows(values, ftBias, active, count, NULL, 0);
+}
+
+static int kingMoved(const NnueAccumulator *acc, int color) {
+    for (int k = 0; k < acc->dirtyCount; k++) {
+        if (acc->dirtyPiece[k] == makePiece(color, KING)) return 1;
+    }
+    return 0;
+}
+
+// Brings one side of 'acc' up to date: forward from the nearest computed
+// ancestor, or from scratch when the root or a move of this side's king,
+// which changes every feature, lies in between
+static void updateAccumulator(const Position *pos, NnueAccumulator *acc, int perspective) {
+    NnueAccumulator *st = acc;
+    while (!st->computed[perspective]) {
+        if (st->dirtyCount < 0 || kingMoved(st, perspective)) {
+            refresh(acc->values[perspective], pos, perspective);
+            acc->computed[perspective] = 1;
+            return;
+        }
+        st--;
+    }
+    int kingSq = lsb(pos->pieces[perspective][KING]);
+    for (NnueAccumulator *next = st + 1; next <= acc; next++) {
+        int added[3], removed[3], addCount = 0, removeCount = 0;
+        for (int k = 0; k < next->dirtyCount; k++) {
+            Piece p = next->dirtyPiece[k];
+            int from = next->dirtyFrom[k], to = next->dirtyTo[k];
+            if (pieceType(p) == KING) continue;
+            if (from != NO_SQUARE) removed[removeCount++] = featureIndex(perspective, kingSq, p, from);
+            if (to != NO_SQUARE) added[addCount++] = featureIndex(perspective, kingSq, p, to);
+        }
+        updateRows(next->values[perspective], (next - 1)->values[perspective], added, addCount, removed, removeCount);
+        next->computed[perspective] = 1;
+    }
+}
+
+// ------------------ ACCUMULATOR STACK ------------------
+// The root of a search: summed from scratch on first use
+void nnueReset(NnueAccumulator *acc) {
+    acc->computed[WHITE] = acc->computed[BLACK] = 0;
+    acc->dirtyCount = -1;
+}
+
+static void addDirty(NnueAccumulator *acc, Piece p, int from, int to) {
+    acc->dirtyPiece[acc->dirtyCount] = p;
+    acc->dirtyFrom[acc->dirtyCount] = (signed char)from;
+    acc->dirtyTo[acc->dirtyCount] = (signed char)to;
+    acc->dirtyCount++;
+}
+
+// Records in 'next' what 'move' will change. Call before makeMove, while
+// 'pos' still shows the pieces where they start.
+void nnuePush(NnueAccumulator *next, const Position *pos, Move move) {
+    int from = moveFrom(move), to = moveTo(move);
+    int flag = moveFlag(move);
+    Piece moved = pos->board[from];
+    next->computed[WHITE] = next->computed[BLACK] = 0;
+    next->dirtyCount = 0;
+
+    if (flag == MOVE_CASTLING) {
+        int rookFrom, rookTo;
+        castlingRookSquares(move, &rookFrom, &rookTo);
+        addDirty(next, moved, from, to);
+        addDirty(next, pos->board[rookFrom], rookFrom, rookTo);
+        return;
+    }
+    int capSq = flag == MOVE_EN_PASSANT ? (to & 7) | (from & 56) : to;
+    if (pos->board[capSq] != NO_PIECE) addDirty(next, pos->board[capSq], capSq, NO_SQUARE);
+    if (flag == MOVE_PROMOTION) {
+        addDirty(next, moved, from, NO_SQUARE);
+        addDirty(next, makePiece(pieceColor(moved), movePromotion(move)), NO_SQUARE, to);
+    } else {
+        addDirty(next, moved, from, to);
+    }
+}
+
+void nnuePushNull(NnueAccumulator *next) {
+    next->computed[WHITE] = next->computed[BLACK] = 0;
+    next->dirtyCount = 0;
+}
+
+// ------------------ FORWARD PASS ------------------
+// Clamps both accumulators to 0..127 as bytes, the side to move's first
+static void transform(uint8_t *out, const int16_t *in) {
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(in + i + 16));
+        // The pack interleaves the 128-bit lanes; the permute puts them back
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_max_epi8(packed, zero));
+    }
+#elif defined(__SSE4_1__)
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(in + i + 8));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_max_epi8(_mm_packs_epi16(a, b), zero));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; i++) out[i] = (uint8_t)(in[i] < 0 ? 0 : in[i] > 127 ? 127 : in[i]);
+#endif
+}
+
+// out[j] = bias[j] + weights[j] . in, for 'in' of unsigned bytes; inCount
+// must be a multiple of 32. The SIMD versions work on a block of rows at a
+// time, so each input chunk is loaded once per block and the horizontal
+// sums are shared.
+static void affine(int32_t *out, const uint8_t *in, int inCount, const int8_t *weights, const int32_t *bias,
+                   int outCount) {
+    int j = 0;
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (; j + 8 <= outCount; j += 8) {
+        __m256i sums[8];
+        for (int r = 0; r < 8; r++) sums[r] = _mm256_setzero_si256();
+        for (int i = 0; i < inCount; i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+            // Unrolled so the eight sums stay in registers
+#pragma GCC unroll 8
+            for (int r = 0; r < 8; r++) {
+                __m256i w = _mm256_loadu_si256((const __m256i *)(weights + (size_t)(j + r) * inCount + i));
+                sums[r] = _mm256_add_epi32(sums[r], _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+            }
+        }
+        // Pairwise adds leave each row's half sums in its own slot of each
+        // 128-bit lane; adding the two lanes finishes all eight rows at once
+        __m256i s0123 = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[0], sums[1]), _mm256_hadd_epi32(sums[2], sums[3]));
+        __m256i s4567 = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[4], sums[5]), _mm256_hadd_epi32(sums[6], sums[7]));
+        __m256i total = _mm256_add_epi32(_mm256_permute2x128_si256(s0123, s4567, 0x20),
+                                         _mm256_permute2x128_si256(s0123, s4567, 0x31));
+        total = _mm256_add_epi32(total, _mm256_loadu_si256((const __m256i *)(bias + j)));
+        _mm256_storeu_si256((__m256i *)(out + j), total);
+    }
+#elif defined(__SSE4_1__)
+    const __m128i ones = _mm_set1_epi16(1);
+    for (; j + 4 <= outCount; j += 4) {
+        __m128i sums[4];
+        for (int r = 0; r < 4; r++) sums[r] = _mm_setzero_si128();
+        for (int i = 0; i < inCount; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+#pragma GCC unroll 4
+            for (int r = 0; r < 4; r++) {
+                __m128i w = _mm_loadu_si128((const __m128i *)(weights + (size_t)(j + r) * inCount + i));
+                sums[r] = _mm_add_epi32(sums[r], _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+            }
+        }
+        __m128i total = _mm_hadd_epi32(_mm_hadd_epi32(sums[0], sums[1]), _mm_hadd_epi32(sums[2], sums[3]));
+        total = _mm_add_epi32(total, _mm_loadu_si128((const __m128i *)(bias + j)));
+        _mm_storeu_si128((__m128i *)(out + j), total);
+    }
+#endif
+    // Rows left over from the blocks, and everything without SIMD
+    for (; j < outCount; j++) {
+        const int8_t *w = weights + (size_t)j * inCount;
+        int32_t sum = bias[j];
+        for (int i = 0; i < inCount; i++) sum += in[i] * w[i];
+        out[j] = sum;
+    }
+}
+
+static void clippedRelu(uint8_t *out, const int32_t *in, int count) {
+    for (int i = 0; i < count; i++) {
+        int v = in[i] >> NNUE_SHIFT;
+        out[i] = (uint8_t)(v < 0 ? 0 : v > 127 ? 127 : v);
+    }
+}
+
+// Centipawns from the side to move's view. 'acc' is this position's entry
+// in a stack whose bottom was set with nnueReset and every later entry with
+// nnuePush or nnuePushNull. Only call it with a network loaded.
+int nnueEvaluate(const Position *pos, NnueAccumulator *acc) {
+    for (int c = WHITE; c <= BLACK; c++) {
+        if (!acc->computed[c]) updateAccumulator(pos, acc, c);
+#ifdef DEBUG_POSITION
+        int16_t check[NNUE_HIDDEN];
+        refresh(check, pos, c);
+        assert(memcmp(check, acc->values[c], sizeof(check)) == 0);
+#endif
+    }
+
+    uint8_t input[2 * NNUE_HIDDEN], hidden1[NNUE_L1], hidden2[NNUE_L2];
+    int32_t sums[NNUE_L1 > NNUE_L2 ? NNUE_L1 : NNUE_L2];
+    int32_t output;
+    int us = pos->sideToMove;
+    transform(input, acc->values[us]);
+    transform(input + NNUE_HIDDEN, acc->values[!us]);
+    affine(sums, input, 2 * NNUE_HIDDEN, l1Weights, l1Bias, NNUE_L1);
+    clippedRelu(hidden1, sums, NNUE_L1);
+    affine(sums, hidden1, NNUE_L1, l2Weights, l2Bias, NNUE_L2);
+    clippedRelu(hidden2, sums, NNUE_L2);
+    affine(&output, hidden2, NNUE_L2, outWeights, outBias, 1);
+
+    int score = output / NNUE_SCALE;
+    return score > NNUE_MAX_SCORE ? NNUE_MAX_SCORE : score < -NNUE_MAX_SCORE ? -NNUE_MAX_SCORE : score;
+}
@@ -0,0 +1,38 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "position.h"
+
+// ------------------ NNUE EVALUATION ------------------
+// Efficiently updatable network: HalfKP inputs (own king square x every
+// non-king piece on its square, seen from each side) feed a 256-wide int16
+// accumulator per side, followed by 512 -> 32 -> 32 -> 1 int8 layers. The
+// accumulator is the expensive part and only changes by the few pieces a
+// move touches, so it is updated from the previous ply's instead of being
+// recomputed. Without a loaded network evaluate() is used instead.
+#define NNUE_INPUTS (64 * 10 * 64) // King square x (piece type, color) x square
+#define NNUE_HIDDEN 256            // Accumulator width per side
+#define NNUE_L1 32
+#define NNUE_L2 32
+
+// One per ply. A push only records what the move changed; the sums are
+// brought up to date when a position is actually evaluated, from the
+// nearest ancestor that has them, so pruned moves cost nothing.
+typedef struct {
+    int16_t values[2][NNUE_HIDDEN]; // [perspective]
+    int computed[2];
+    int dirtyCount;       // Pieces the move into this ply touched; -1 at the root
+    Piece dirtyPiece[3];
+    signed char dirtyFrom[3], dirtyTo[3]; // NO_SQUARE when added or removed
+} NnueAccumulator;
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+int nnueLoad(const char *path);
+void nnueUnload(void);
+int nnueLoaded(void);
+void nnueReset(NnueAccumulator *acc);
+void nnuePush(NnueAccumulator *next, const Position *pos, Move move);
+void nnuePushNull(NnueAccumulator *next);
+int nnueEvaluate(const Position *pos, NnueAccumulator *acc);
+
+#endif
@@ -0,0 +1,103 @@
+#include "pawns.h"
+#include "evaluate.h"
+
+// Passed pawn bonus by rank from the owner's side; the rest of the
+// advancement credit comes from the piece-square tables
+static const int passedBonus[2][8] = {
+    {0, 5, 10, 15, 25, 40, 60, 0},
+    {0, 10, 15, 25, 40, 65, 100, 0},
+};
+
+static const int doubledPenalty[2] = {10, 20};
+static const int isolatedPenalty[2] = {10, 15};
+static const int backwardPenalty[2] = {8, 10};
+
+// Shield bonus for the nearest own pawn in front of the king on its file
+// and the two beside it, by its distance; an open file costs instead
+static const int shieldBonus[3] = {0, 15, 8};
+#define OPEN_FILE_PENALTY 12
+
+// Full computation of the pawn terms, written into 'e'
+void evaluatePawns(const Position *pos, PawnEntry *e) {
+    int score[2] = {0, 0};
+    for (int c = WHITE; c <= BLACK; c++) {
+        Bitboard ours = pos->pieces[c][PAWN], theirs = pos->pieces[!c][PAWN];
+        int sign = c == WHITE ? 1 : -1;
+        Bitboard b = ours;
+        e->passed[c] = 0;
+        while (b) {
+            int sq = popLsb(&b);
+            int file = squareCol(sq);
+            int rank = c == WHITE ? squareRank(sq) : 7 - squareRank(sq);
+            Bitboard front = forwardRanksBB(c, sq);
+            Bitboard neighbours = ours & adjacentFilesBB(file);
+
+            // Only the front pawn of a doubled pair can be passed
+            if (ours & front & fileBB(file)) {
+                for (int s = MG; s <= EG; s++) score[s] -= sign * doubledPenalty[s];
+            } else if (!(theirs & front & (fileBB(file) | adjacentFilesBB(file)))) {
+                e->passed[c] |= SQUARE_BB(sq);
+                for (int s = MG; s <= EG; s++) score[s] += sign * passedBonus[s][rank];
+            }
+
+            // Isolated: no pawn of ours beside it. Backward: every neighbour
+            // is ahead of it and an enemy pawn guards the square in front,
+            // so it can neither be defended nor advance safely.
+            if (!neighbours) {
+                for (int s = MG; s <= EG; s++) score[s] -= sign * isolatedPenalty[s];
+            } else if (!(neighbours & ~front)) {
+                int stop = c == WHITE ? sq + 8 : sq - 8;
+                if (stop >= 0 && stop < 64 && (pawnAttacks[c][stop] & theirs)) {
+                    for (int s = MG; s <= EG; s++) score[s] -= sign * backwardPenalty[s];
+                }
+            }
+        }
+    }
+    e->key = pos->pawnKey;
+    e->score[MG] = (int16_t)score[MG];
+    e->score[EG] = (int16_t)score[EG];
+    e->kingSq[WHITE] = e->kingSq[BLACK] = 0;
+}
+
+// The entry for the current pawns, computed on a miss. A position without
+// pawns has key 0, as does an unused entry, which is harmless: a zeroed
+// entry holds exactly the terms of no pawns and no shield computed yet.
+PawnEntry *probePawns(const Position *pos, PawnTable *table) {
+    PawnEntry *e = &table->entries[pos->pawnKey & (PAWN_TABLE_SIZE - 1)];
+    table->probes++;
+    if (e->key == pos->pawnKey) {
+        table->hits++;
+        return e;
+    }
+    evaluatePawns(pos, e);
+    return e;
+}
+
+static int computeShelter(const Position *pos, int color, int kingSq) {
+    Bitboard ours = pos->pieces[color][PAWN];
+    int kingFile = squareCol(kingSq);
+    int shelter = 0;
+    for (int f = kingFile > 0 ? kingFile - 1 : 0; f <= (kingFile < 7 ? kingFile + 1 : 7); f++) {
+        Bitboard shield = ours & fileBB(f) & forwardRanksBB(color, kingSq);
+        if (!shield) {
+            shelter -= OPEN_FILE_PENALTY;
+            continue;
+        }
+        int nearest = color == WHITE ? lsb(shield) : 63 - __builtin_clzll(shield);
+        int distance = squareRank(nearest) - squareRank(kingSq);
+        distance = distance < 0 ? -distance : distance;
+        if (distance < 3) shelter += shieldBonus[distance];
+    }
+    return shelter;
+}
+
+// Middlegame shield of 'color's king, recomputed only when the king has
+// moved since the entry last answered
+int kingShelter(PawnEntry *e, const Position *pos, int color) {
+    int kingSq = lsb(pos->pieces[color][KING]);
+    if (e->kingSq[color] != kingSq + 1) {
+        e->kingSq[color] = (signed char)(kingSq + 1);
+        e->shelter[color] = (int16_t)computeShelter(pos, color, kingSq);
+    }
+    return e->shelter[color];
+}
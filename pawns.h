@@ -0,0 +1,31 @@
+#ifndef PAWNS_H
+#define PAWNS_H
+
+#include "position.h"
+
+// ------------------ PAWN STRUCTURE ------------------
+// Pawn terms depend on the pawns alone, which few moves change, so each
+// search thread caches them by the position's pawn key. The king shield
+// also depends on where the king stands and is cached for the last king
+// square seen.
+#define PAWN_TABLE_SIZE 16384 // Entries per thread, a power of two
+
+typedef struct {
+    uint64_t key;
+    Bitboard passed[2];    // Passed pawns per color
+    int16_t score[2];      // [MG] and [EG], White minus Black, shield excluded
+    int16_t shelter[2];    // Middlegame shield of each color's king...
+    signed char kingSq[2]; // ...standing on this square + 1, or 0 before the first lookup
+} PawnEntry;
+
+typedef struct {
+    PawnEntry entries[PAWN_TABLE_SIZE];
+    uint64_t probes, hits; // Owner thread's lookups since the last reset
+} PawnTable;
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+void evaluatePawns(const Position *pos, PawnEntry *e);
+PawnEntry *probePawns(const Position *pos, PawnTable *table);
+int kingShelter(PawnEntry *e, const Position *pos, int color);
+
+#endif
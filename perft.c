@@ -0,0 +1,401 @@
+// Headless perft: counts leaf nodes of the legal move tree to a fixed depth.
+// gcc -O2 -pthread perft.c bitboard.c position.c movegen.c evaluate.c pawns.c material.c endgame.c -o perft
+//   ./perft [options] <depth> [FEN]   count from a position (start position by default)
+//   ./perft [options] --suite         check the standard positions against known counts
+// Options: --divide        print the count under every root move
+//          --threads N     split the tree into tasks run by N work-stealing threads
+//          --hash MB       share a lock-free perft hash table of this size
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "movegen.h"
+#include "timer.h"
+
+typedef struct {
+    const char *fen;
+    int depth;
+    uint64_t nodes;
+} PerftCase;
+
+static const PerftCase suite[] = {
+    {START_FEN, 5, 4865609ULL},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603ULL},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083ULL},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292ULL},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487ULL},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594ULL},
+};
+
+// ------------------ PERFT HASH TABLE ------------------
+// Each entry stores (key ^ data, data). A reader accepts the entry only when
+// the two halves XOR back to its key, so a write torn by another thread reads
+// as a miss and no lock is needed.
+typedef struct {
+    _Atomic uint64_t check;
+    _Atomic uint64_t data; // nodes << 6 | depth
+} HashEntry;
+
+static HashEntry *hashTable = NULL;
+static uint64_t hashMask = 0;
+
+static void initHash(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(HashEntry) <= megabytes * 1024 * 1024) count *= 2;
+    hashTable = calloc(count, sizeof(HashEntry));
+    hashMask = hashTable ? count - 1 : 0;
+}
+
+static int probeHash(uint64_t key, int depth, uint64_t *nodes) {
+    HashEntry *e = &hashTable[key & hashMask];
+    uint64_t data = atomic_load_explicit(&e->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&e->check, memory_order_relaxed);
+    if ((check ^ data) != key || (int)(data & 63) != depth) return 0;
+    *nodes = data >> 6;
+    return 1;
+}
+
+static void storeHash(uint64_t key, int depth, uint64_t nodes) {
+    HashEntry *e = &hashTable[key & hashMask];
+    uint64_t data = (nodes << 6) | (uint64_t)depth;
+    atomic_store_explicit(&e->data, data, memory_order_relaxed);
+    atomic_store_explicit(&e->check, key ^ data, memory_order_relaxed);
+}
+
+// ------------------ SERIAL PERFT ------------------
+// Bulk counting: at the last ply the number of legal moves is the leaf count
+static uint64_t perft(Position *pos, int depth) {
+    if (depth == 0) return 1;
+    Move moves[MAX_MOVES];
+    int count = generateLegalMoves(pos, moves);
+    if (depth == 1) return (uint64_t)count;
+
+    uint64_t nodes;
+    if (hashTable && probeHash(pos->key, depth, &nodes)) return nodes;
+
+    nodes = 0;
+    StateInfo st;
+    for (int i = 0; i < count; i++) {
+        makeMove(pos, moves[i], &st);
+        nodes += perft(pos, depth - 1);
+        unmakeMove(pos, moves[i], &st);
+    }
+    if (hashTable) storeHash(pos->key, depth, nodes);
+    return nodes;
+}
+
+// ------------------ WORK-STEALING TASK POOL ------------------
+#define MAX_THREADS 256
+#define DEQUE_SIZE 4096   // Tasks per thread; a full deque runs work inline
+#define MIN_SPLIT_DEPTH 3 // Subtrees this shallow are never handed out
+#define BACKOFF_YIELDS 16 // Failed steal rounds that only yield before a thief sleeps
+#define BACKOFF_SLEEP_NS 50000 // Its sleep between later rounds
+
+typedef struct {
+    Position pos;
+    int depth;
+    int slot; // Root move whose counter receives the nodes
+} Task;
+
+// Owner pushes and pops at the bottom (depth first), thieves take from the
+// top where the oldest, largest subtrees sit
+typedef struct {
+    atomic_flag lock;
+    atomic_int top, bottom; // Changed under the lock; read without it to skip empty deques
+    Task *tasks;
+} Deque;
+
+typedef struct {
+    pthread_t thread;
+    int id;
+    Deque deque;
+    uint64_t rng;
+    uint64_t steals;
+} Worker;
+
+static Worker workers[MAX_THREADS];
+static int threadCount = 1;
+static atomic_int pendingTasks; // Pushed but not yet finished
+static atomic_int idleWorkers;
+static _Atomic uint64_t rootCounts[MAX_MOVES];
+
+static void lockDeque(Deque *d) {
+    while (atomic_flag_test_and_set_explicit(&d->lock, memory_order_acquire)) {
+    }
+}
+
+static void unlockDeque(Deque *d) {
+    atomic_flag_clear_explicit(&d->lock, memory_order_release);
+}
+
+static inline int loadIndex(atomic_int *i) {
+    return atomic_load_explicit(i, memory_order_relaxed);
+}
+
+static inline void storeIndex(atomic_int *i, int value) {
+    atomic_store_explicit(i, value, memory_order_relaxed);
+}
+
+static int pushTask(Worker *w, const Task *t) {
+    Deque *d = &w->deque;
+    lockDeque(d);
+    int top = loadIndex(&d->top), bottom = loadIndex(&d->bottom);
+    int ok = bottom - top < DEQUE_SIZE;
+    if (ok) {
+        d->tasks[bottom % DEQUE_SIZE] = *t;
+        storeIndex(&d->bottom, bottom + 1);
+        atomic_fetch_add(&pendingTasks, 1);
+    }
+    unlockDeque(d);
+    return ok;
+}
+
+static int popTask(Worker *w, Task *t) {
+    Deque *d = &w->deque;
+    if (loadIndex(&d->bottom) == loadIndex(&d->top)) return 0; // Only the owner adds tasks
+    lockDeque(d);
+    int top = loadIndex(&d->top), bottom = loadIndex(&d->bottom);
+    int ok = bottom > top;
+    if (ok) {
+        *t = d->tasks[(bottom - 1) % DEQUE_SIZE];
+        storeIndex(&d->bottom, bottom - 1);
+    }
+    unlockDeque(d);
+    return ok;
+}
+
+// An empty-looking deque is passed over without taking its lock, so idle
+// thieves do not hold up the owner
+static int stealTask(Worker *victim, Task *t) {
+    Deque *d = &victim->deque;
+    if (loadIndex(&d->bottom) <= loadIndex(&d->top)) return 0;
+    lockDeque(d);
+    int top = loadIndex(&d->top), bottom = loadIndex(&d->bottom);
+    int ok = bottom > top;
+    if (ok) {
+        *t = d->tasks[top % DEQUE_SIZE];
+        storeIndex(&d->top, top + 1);
+    }
+    unlockDeque(d);
+    return ok;
+}
+
+// After every round of failed steals: yield the core at first, then sleep
+// briefly so long idle spells leave the busy threads alone
+static void backOff(int rounds) {
+    if (rounds < BACKOFF_YIELDS) {
+        sched_yield();
+    } else {
+        struct timespec pause = {0, BACKOFF_SLEEP_NS};
+        nanosleep(&pause, NULL);
+    }
+}
+
+// Counts like perft() but, while any thread is idle, hands the remaining
+// sibling subtrees out as tasks. Returns only the nodes counted here; handed
+// out tasks add their own totals to the root counter.
+static uint64_t perftSplit(Worker *w, Position *pos, int depth, int slot) {
+    if (depth <= MIN_SPLIT_DEPTH) return perft(pos, depth);
+
+    uint64_t nodes;
+    if (hashTable && probeHash(pos->key, depth, &nodes)) return nodes;
+
+    Move moves[MAX_MOVES];
+    int count = generateLegalMoves(pos, moves);
+    StateInfo st;
+    int complete = 1;
+    nodes = 0;
+    for (int i = 0; i < count; i++) {
+        if (complete && i + 1 < count && atomic_load_explicit(&idleWorkers, memory_order_relaxed) > 0) {
+            complete = 0;
+            for (int j = i + 1; j < count; j++) {
+                Task t = {*pos, depth - 1, slot};
+                makeMove(&t.pos, moves[j], &st);
+                if (!pushTask(w, &t)) nodes += perftSplit(w, &t.pos, depth - 1, slot);
+            }
+            count = i + 1;
+        }
+        makeMove(pos, moves[i], &st);
+        nodes += perftSplit(w, pos, depth - 1, slot);
+        unmakeMove(pos, moves[i], &st);
+    }
+    if (hashTable && complete) storeHash(pos->key, depth, nodes);
+    return nodes;
+}
+
+static void runTask(Worker *w, Task *t) {
+    uint64_t nodes = perftSplit(w, &t->pos, t->depth, t->slot);
+    atomic_fetch_add(&rootCounts[t->slot], nodes);
+    atomic_fetch_sub(&pendingTasks, 1);
+}
+
+static void *workerLoop(void *arg) {
+    Worker *w = arg;
+    Task t;
+    for (;;) {
+        if (popTask(w, &t)) {
+            runTask(w, &t);
+            continue;
+        }
+
+        // Out of local work: steal from random victims until the tree is done
+        atomic_fetch_add(&idleWorkers, 1);
+        int found = 0, attempts = 0;
+        while (!found && atomic_load(&pendingTasks) > 0) {
+            w->rng ^= w->rng << 13;
+            w->rng ^= w->rng >> 7;
+            w->rng ^= w->rng << 17;
+            Worker *victim = &workers[w->rng % (uint64_t)threadCount];
+            if (victim != w && stealTask(victim, &t)) found = 1;
+            else if (++attempts % threadCount == 0) backOff(attempts / threadCount);
+        }
+        atomic_fetch_sub(&idleWorkers, 1);
+        if (!found) return NULL;
+        w->steals++;
+        runTask(w, &t);
+    }
+}
+
+// Root moves become the first tasks, spread round-robin over the deques
+static uint64_t perftParallel(Position *pos, int depth, Move *moves, int count) {
+    atomic_store(&pendingTasks, 0);
+    atomic_store(&idleWorkers, 0);
+    for (int i = 0; i < count; i++) {
+        atomic_store(&rootCounts[i], 0);
+        Task t = {*pos, depth - 1, i};
+        StateInfo st;
+        makeMove(&t.pos, moves[i], &st);
+        if (!pushTask(&workers[i % threadCount], &t)) return 0;
+    }
+
+    for (int i = 1; i < threadCount; i++) pthread_create(&workers[i].thread, NULL, workerLoop, &workers[i]);
+    workerLoop(&workers[0]);
+    for (int i = 1; i < threadCount; i++) pthread_join(workers[i].thread, NULL);
+
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) total += atomic_load(&rootCounts[i]);
+    return total;
+}
+
+static int initWorkers(void) {
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].id = i;
+        workers[i].rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+        workers[i].deque.tasks = malloc(sizeof(Task) * DEQUE_SIZE);
+        atomic_flag_clear(&workers[i].deque.lock);
+        if (!workers[i].deque.tasks) return 0;
+    }
+    return 1;
+}
+
+// ------------------ DRIVER ------------------
+// Counts the tree under 'pos', per root move when 'divideMode' is set
+static uint64_t countNodes(Position *pos, int depth, int divideMode) {
+    if (depth == 0) return 1; // The position itself, with no moves to divide by
+    Move moves[MAX_MOVES];
+    int count = generateLegalMoves(pos, moves);
+    if (depth == 1 && !divideMode) return (uint64_t)count;
+
+    uint64_t total = 0;
+    if (threadCount > 1 && depth > 1) {
+        total = perftParallel(pos, depth, moves, count);
+    } else {
+        StateInfo st;
+        for (int i = 0; i < count; i++) {
+            makeMove(pos, moves[i], &st);
+            rootCounts[i] = perft(pos, depth - 1);
+            unmakeMove(pos, moves[i], &st);
+            total += rootCounts[i];
+        }
+    }
+
+    if (divideMode) {
+        char buf[6];
+        for (int i = 0; i < count; i++) {
+            moveToString(moves[i], buf);
+            printf("%s: %llu\n", buf, (unsigned long long)atomic_load(&rootCounts[i]));
+        }
+    }
+    return total;
+}
+
+static void printRate(uint64_t nodes, double ms) {
+    printf("Nodes: %llu  Time: %.0f ms  %.0f nodes/sec\n", (unsigned long long)nodes, ms,
+           ms > 0 ? nodes * 1000.0 / ms : 0.0);
+    if (threadCount > 1) {
+        uint64_t steals = 0;
+        for (int i = 0; i < threadCount; i++) steals += workers[i].steals;
+        printf("Threads: %d  Steals: %llu\n", threadCount, (unsigned long long)steals);
+    }
+}
+
+static int runSuite(void) {
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    double start = nowMs();
+    for (size_t i = 0; i < sizeof(suite) / sizeof(suite[0]); i++) {
+        Position pos;
+        setPositionFromFEN(&pos, suite[i].fen);
+        uint64_t nodes = countNodes(&pos, suite[i].depth, 0);
+        totalNodes += nodes;
+        int ok = nodes == suite[i].nodes;
+        failures += !ok;
+        printf("%s depth %d: %llu (expected %llu) %s\n", suite[i].fen, suite[i].depth,
+               (unsigned long long)nodes, (unsigned long long)suite[i].nodes, ok ? "ok" : "FAIL");
+    }
+    printRate(totalNodes, nowMs() - start);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    int argi = 1, divideMode = 0, suiteMode = 0;
+    size_t hashMb = 0;
+    initBitboards();
+    initZobrist();
+
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strcmp(argv[argi], "--suite") == 0) suiteMode = 1;
+        else if (strcmp(argv[argi], "--divide") == 0) divideMode = 1;
+        else if (strcmp(argv[argi], "--threads") == 0 && argi + 1 < argc) threadCount = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "--hash") == 0 && argi + 1 < argc) hashMb = (size_t)atol(argv[++argi]);
+        else break;
+    }
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_THREADS) threadCount = MAX_THREADS;
+    if (threadCount > 1 && !initWorkers()) {
+        printf("Out of memory for task deques\n");
+        return 1;
+    }
+    if (hashMb > 0) {
+        initHash(hashMb);
+        if (!hashTable) printf("Could not allocate %zu MB hash, continuing without\n", hashMb);
+    }
+
+    if (suiteMode) return runSuite();
+    if (argi >= argc) {
+        printf("Usage: %s [--divide] [--threads N] [--hash MB] <depth> [FEN] | --suite\n", argv[0]);
+        return 1;
+    }
+    int depth = atoi(argv[argi++]);
+    if (depth < 0) depth = 0;
+
+    // The FEN may arrive as one quoted argument or split on its spaces
+    char fen[256] = "";
+    for (; argi < argc; argi++) {
+        if (fen[0]) strncat(fen, " ", sizeof(fen) - strlen(fen) - 1);
+        strncat(fen, argv[argi], sizeof(fen) - strlen(fen) - 1);
+    }
+    Position pos;
+    if (!setPositionFromFEN(&pos, fen[0] ? fen : START_FEN)) {
+        printf("Bad FEN: %s\n", fen);
+        return 1;
+    }
+
+    double start = nowMs();
+    uint64_t nodes = countNodes(&pos, depth, divideMode);
+    printRate(nodes, nowMs() - start);
+    return 0;
+}
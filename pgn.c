@@ -0,0 +1,244 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pgn.h"
+
+static inline int isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Characters that end a move token besides white space
+static inline int endsToken(char c) {
+    return isSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == ';' || c == '[' || c == '$';
+}
+
+static inline PgnSpan span(const char *from, const char *to) {
+    return (PgnSpan){from, (int)(to - from)};
+}
+
+static int spanIs(PgnSpan s, const char *word) {
+    int n = (int)strlen(word);
+    return s.length == n && memcmp(s.text, word, (size_t)n) == 0;
+}
+
+// The value of a tag, or an empty span
+PgnSpan pgnTag(const PgnGame *game, const char *name) {
+    for (int i = 0; i < game->tagCount; i++) {
+        if (spanIs(game->tags[i].name, name)) return game->tags[i].value;
+    }
+    return (PgnSpan){NULL, 0};
+}
+
+static int resultOf(PgnSpan s) {
+    if (spanIs(s, "1-0")) return PGN_WHITE_WINS;
+    if (spanIs(s, "0-1")) return PGN_BLACK_WINS;
+    if (spanIs(s, "1/2-1/2")) return PGN_DRAW;
+    return PGN_UNKNOWN;
+}
+
+// Sets up the position the game starts from: its FEN tag, else the usual
+// one. Returns 0 if the FEN tag cannot be read or is not a legal position.
+int pgnStartPosition(const PgnGame *game, Position *pos) {
+    PgnSpan fen = pgnTag(game, "FEN");
+    if (!fen.text) {
+        initPosition(pos);
+        return 1;
+    }
+    char buf[128];
+    if (fen.length >= (int)sizeof(buf)) return 0;
+    memcpy(buf, fen.text, (size_t)fen.length);
+    buf[fen.length] = '\0';
+    return setPositionFromFEN(pos, buf);
+}
+
+// ------------------ TOKENIZER ------------------
+// Reads a tag pair from its '['; returns where the line goes on
+static const char *readTag(PgnGame *game, const char *p, const char *end) {
+    const char *q = p + 1;
+    while (q < end && (*q == ' ' || *q == '\t')) q++;
+    const char *name = q;
+    while (q < end && !isSpace(*q) && *q != '"' && *q != ']') q++;
+    PgnSpan tagName = span(name, q);
+    while (q < end && *q != '"' && *q != ']' && *q != '\n') q++;
+
+    PgnSpan value = {NULL, 0};
+    if (q < end && *q == '"') {
+        const char *from = ++q;
+        while (q < end && *q != '"' && *q != '\n') q += (*q == '\\' && q + 1 < end) ? 2 : 1;
+        value = span(from, q < end ? q : end);
+    }
+    if (tagName.length && game->tagCount < PGN_MAX_TAGS) {
+        game->tags[game->tagCount].name = tagName;
+        game->tags[game->tagCount++].value = value;
+    }
+    while (q < end && *q != ']' && *q != '\n') q++;
+    return q < end ? q + 1 : end;
+}
+
+// Skips a variation from its '(' to the matching ')', passing over comments
+static const char *skipVariation(const char *p, const char *end) {
+    for (int depth = 0; p < end; p++) {
+        if (*p == '(') {
+            depth++;
+        } else if (*p == ')') {
+            if (--depth == 0) return p + 1;
+        } else if (*p == '{') {
+            const char *close = memchr(p, '}', (size_t)(end - p));
+            if (!close) return end;
+            p = close;
+        } else if (*p == ';') {
+            const char *close = memchr(p, '\n', (size_t)(end - p));
+            if (!close) return end;
+            p = close;
+        }
+    }
+    return end;
+}
+
+static void resetGame(PgnGame *game, const char *start) {
+    game->text = span(start, start);
+    game->tagCount = game->moveCount = game->droppedMoves = 0;
+    game->comment = (PgnSpan){NULL, 0};
+    game->result = PGN_UNKNOWN;
+}
+
+static int finishGame(PgnGame *game, const char *end, PgnGameFn fn, void *arg) {
+    game->text.length = (int)(end - game->text.text);
+    if (game->result == PGN_UNKNOWN) game->result = resultOf(pgnTag(game, "Result"));
+    return fn(game, arg);
+}
+
+// Tokenizes every game in the text and hands each to 'fn'. A game ends at
+// its result, at a tag after its moves, or at the end of the text. Returns
+// the number of games passed.
+size_t pgnParse(const char *text, size_t length, PgnGameFn fn, void *arg) {
+    PgnGame *game = malloc(sizeof(PgnGame));
+    if (!game) return 0;
+    const char *p = text, *end = text + length;
+    size_t games = 0;
+    int started = 0, inMoves = 0; // Something of this game was read; its moves were reached
+    int running = 1;
+    resetGame(game, p);
+
+    while (running) {
+        while (p < end && isSpace(*p)) p++;
+        if (p == end) break;
+        if (!started) resetGame(game, p);
+        started = 1;
+
+        if (*p == '[') {
+            if (inMoves) {
+                games++;
+                running = finishGame(game, p, fn, arg);
+                resetGame(game, p);
+                inMoves = 0;
+            }
+            p = readTag(game, p, end);
+            continue;
+        }
+
+        inMoves = 1;
+        PgnMove *last = game->moveCount ? &game->moves[game->moveCount - 1] : NULL;
+        if (*p == '{' || *p == ';') {
+            const char *close = memchr(p, *p == '{' ? '}' : '\n', (size_t)(end - p));
+            if (!close) close = end;
+            PgnSpan comment = span(p + 1, close);
+            if (last && !last->comment.text) last->comment = comment;
+            else if (!last && !game->comment.text) game->comment = comment;
+            p = close < end ? close + 1 : end;
+        } else if (*p == '(') {
+            const char *close = skipVariation(p, end);
+            if (last) {
+                if (!last->variations.text) last->variations.text = p;
+                last->variations.length = (int)(close - last->variations.text);
+            }
+            p = close;
+        } else if (*p == '$') {
+            int nag = 0;
+            for (p++; p < end && *p >= '0' && *p <= '9'; p++) nag = nag * 10 + (*p - '0');
+            if (last && !last->nag) last->nag = nag;
+        } else if (*p == '%' && (p == text || p[-1] == '\n')) {
+            const char *close = memchr(p, '\n', (size_t)(end - p));
+            p = close ? close : end;
+        } else if ((*p >= '1' && *p <= '9') || *p == '.' || *p == ')' || *p == '}' || *p == '!' || *p == '?') {
+            // Move numbers ("12." or "12...", maybe run into the move), stray
+            // closers, loose annotation glyphs, or a result
+            const char *from = p;
+            while (p < end && *p >= '0' && *p <= '9') p++;
+            if (p < end && *p == '.') {
+                while (p < end && *p == '.') p++;
+                continue;
+            }
+            while (p < end && !endsToken(*p)) p++;
+            if (p == from) p++;
+            int result = resultOf(span(from, p));
+            if (result != PGN_UNKNOWN) {
+                game->result = result;
+                games++;
+                running = finishGame(game, p, fn, arg);
+                started = inMoves = 0;
+            }
+        } else if (*p == '*') {
+            games++;
+            running = finishGame(game, ++p, fn, arg);
+            started = inMoves = 0;
+        } else {
+            const char *from = p;
+            while (p < end && !endsToken(*p)) p++;
+            if (p == from) p++;
+            PgnSpan token = span(from, p);
+            if (spanIs(token, "0-1")) {
+                game->result = PGN_BLACK_WINS;
+                games++;
+                running = finishGame(game, p, fn, arg);
+                started = inMoves = 0;
+            } else if (game->moveCount < PGN_MAX_PLIES) {
+                PgnMove *move = &game->moves[game->moveCount++];
+                move->san = token;
+                move->comment = move->variations = (PgnSpan){NULL, 0};
+                move->nag = 0;
+            } else {
+                game->droppedMoves++;
+            }
+        }
+    }
+    if (running && started) {
+        games++;
+        finishGame(game, end, fn, arg);
+    }
+    free(game);
+    return games;
+}
+
+// ------------------ SPLITTING ------------------
+// Cuts the text into up to 'parts' pieces of about equal size, each made of
+// whole games, for parsing on separate threads. A piece starts at a tag
+// line after a blank line. 'starts' gets the offset of every piece and the
+// text length after the last, so it needs parts + 1 places. Returns the
+// number of pieces.
+int pgnSplit(const char *text, size_t length, int parts, size_t *starts) {
+    int count = 0;
+    starts[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t from = length / (size_t)parts * (size_t)i;
+        if (from < starts[count] + 1) from = starts[count] + 1;
+        size_t cut = length;
+        while (from < length) {
+            const char *nl = memchr(text + from, '\n', length - from);
+            if (!nl) break;
+            size_t at = (size_t)(nl - text);
+            if (at + 1 < length && text[at + 1] == '[') {
+                size_t j = at;
+                if (j > 0 && text[j - 1] == '\r') j--;
+                if (j > 0 && text[j - 1] == '\n') {
+                    cut = at + 1;
+                    break;
+                }
+            }
+            from = at + 1;
+        }
+        if (cut >= length) break;
+        starts[++count] = cut;
+    }
+    starts[++count] = length;
+    return count;
+}
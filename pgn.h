@@ -0,0 +1,55 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <stddef.h>
+#include "position.h"
+
+// ------------------ PGN GAMES ------------------
+// Games in Portable Game Notation, tokenized where they lie in memory
+// (usually a mapped file): every field below is a span of that text, not
+// a copy, and nothing is allocated per game or token. Only the main line's
+// moves are listed; variations are kept as spans after the move they
+// replace and are not parsed further.
+#define PGN_MAX_TAGS 32
+#define PGN_MAX_PLIES 1024 // Moves kept of one game; later ones are dropped and counted
+
+enum { PGN_UNKNOWN, PGN_WHITE_WINS, PGN_BLACK_WINS, PGN_DRAW };
+
+// ------------------ STRUCT DEFINITIONS ------------------
+typedef struct {
+    const char *text; // Not NUL-terminated; NULL when absent
+    int length;
+} PgnSpan;
+
+typedef struct {
+    PgnSpan name, value; // The value without its quotes, escapes left as written
+} PgnTag;
+
+// A main-line move in SAN with what follows it up to the next move: the
+// first comment and NAG, and the variations from the first '(' to the last ')'
+typedef struct {
+    PgnSpan san, comment, variations;
+    int nag;
+} PgnMove;
+
+typedef struct {
+    PgnSpan text;         // The whole game, tags to result
+    PgnTag tags[PGN_MAX_TAGS];
+    int tagCount;
+    PgnSpan comment;      // Comment before the first move
+    PgnMove moves[PGN_MAX_PLIES];
+    int moveCount;
+    int droppedMoves;     // Moves past PGN_MAX_PLIES
+    int result;           // PGN_WHITE_WINS etc., from the movetext or else the Result tag
+} PgnGame;
+
+// Called for every game in order; returning 0 stops the parse
+typedef int (*PgnGameFn)(const PgnGame *game, void *arg);
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+size_t pgnParse(const char *text, size_t length, PgnGameFn fn, void *arg);
+int pgnSplit(const char *text, size_t length, int parts, size_t *starts);
+PgnSpan pgnTag(const PgnGame *game, const char *name);
+int pgnStartPosition(const PgnGame *game, Position *pos);
+
+#endif
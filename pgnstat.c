@@ -0,0 +1,160 @@
+// PGN statistics: tokenizes game collections with pgn.c and counts what is
+// in them, as a check of the parser and a measure of its speed.
+// gcc -O2 -pthread pgnstat.c pgn.c mapfile.c bitboard.c position.c movegen.c evaluate.c pawns.c material.c
+//     endgame.c -o pgnstat
+//   ./pgnstat [options] games.pgn ...
+//   ./pgnstat --suite            check the parser on built-in games
+// Options: --threads N    parse each file in N pieces cut at game boundaries
+//          --replay       also play every move through the rules code and
+//                         count the games with a move that cannot be read
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mapfile.h"
+#include "movegen.h"
+#include "pgn.h"
+#include "timer.h"
+
+#define MAX_THREADS 64
+
+typedef struct {
+    const char *text;
+    size_t length;
+    uint64_t games, moves, tags, comments, nags, variations, dropped, results[4], illegal;
+} Counts;
+
+typedef struct {
+    const char *name, *pgn;
+    uint64_t games, moves, unreadable;
+} PgnCase;
+
+static const PgnCase suite[] = {
+    {"movetext", "[Event \"x\"]\n[Result \"1-0\"]\n\n{start} 1. e4 $1 e5 (1... c5 {Sicilian} (1... e6)) 2. Nf3 Nc6 "
+                 "3. Bc4 Nf6 4. O-O Be7 5. d4 exd4 6. e5 Ne4 1-0\n\n1.d4 d5 2.c4 dxc4 ; comment\n3.e4 *\n",
+     2, 17, 0},
+    {"fen tag", "[FEN \"4k3/8/8/8/8/8/4P3/4K3 w - - 0 1\"]\n\n1. e4 Kd7 2. e5 Ke6 1/2-1/2\n", 1, 4, 0},
+    {"illegal move", "1. e4 e5 2. Ke3 Nf6 0-1\n", 1, 4, 1},
+    {"no black king", "[FEN \"8/8/8/8/8/8/8/4K3 w - - 0 1\"]\n\n1. Kd2 1-0\n", 1, 1, 1},
+    {"king in check", "[FEN \"4k3/4R3/8/8/8/8/8/4K3 w - - 0 1\"]\n\n1. Rxe8+ 1-0\n", 1, 1, 1},
+};
+
+static int replay = 0;
+
+// Plays the main line from the start position; returns 0 at the first move
+// that is not legal there
+static int replayGame(const PgnGame *game) {
+    Position pos;
+    if (!pgnStartPosition(game, &pos)) return 0;
+    for (int i = 0; i < game->moveCount; i++) {
+        Move move = parseSan(&pos, game->moves[i].san.text, game->moves[i].san.length);
+        if (move == MOVE_NONE) return 0;
+        StateInfo st;
+        makeMove(&pos, move, &st);
+    }
+    return 1;
+}
+
+static int countGame(const PgnGame *game, void *arg) {
+    Counts *c = arg;
+    c->games++;
+    c->moves += (uint64_t)game->moveCount;
+    c->tags += (uint64_t)game->tagCount;
+    c->dropped += (uint64_t)game->droppedMoves;
+    c->results[game->result]++;
+    if (game->comment.text) c->comments++;
+    for (int i = 0; i < game->moveCount; i++) {
+        const PgnMove *m = &game->moves[i];
+        if (m->comment.text) c->comments++;
+        if (m->nag) c->nags++;
+        if (m->variations.text) c->variations++;
+    }
+    if (replay && !replayGame(game)) c->illegal++;
+    return 1;
+}
+
+static void *parseWorker(void *arg) {
+    Counts *c = arg;
+    pgnParse(c->text, c->length, countGame, c);
+    return NULL;
+}
+
+// Parses and replays each built-in case and compares what was counted
+static int runSuite(void) {
+    int failures = 0;
+    replay = 1;
+    for (size_t i = 0; i < sizeof(suite) / sizeof(suite[0]); i++) {
+        Counts c = {.text = suite[i].pgn, .length = strlen(suite[i].pgn)};
+        pgnParse(c.text, c.length, countGame, &c);
+        int ok = c.games == suite[i].games && c.moves == suite[i].moves && c.illegal == suite[i].unreadable;
+        failures += !ok;
+        printf("%-14s games %llu moves %llu unreadable %llu (expected %llu %llu %llu) %s\n", suite[i].name,
+               (unsigned long long)c.games, (unsigned long long)c.moves, (unsigned long long)c.illegal,
+               (unsigned long long)suite[i].games, (unsigned long long)suite[i].moves,
+               (unsigned long long)suite[i].unreadable, ok ? "ok" : "FAIL");
+    }
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    int threadCount = 1, argi = 1, suiteMode = 0;
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        if (strcmp(argv[argi], "--threads") == 0 && argi + 1 < argc) threadCount = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "--replay") == 0) replay = 1;
+        else if (strcmp(argv[argi], "--suite") == 0) suiteMode = 1;
+        else break;
+    }
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_THREADS) threadCount = MAX_THREADS;
+    initBitboards();
+    initZobrist();
+    if (suiteMode) return runSuite();
+    if (argi >= argc) {
+        printf("Usage: %s [--threads N] [--replay] games.pgn... | --suite\n", argv[0]);
+        return 1;
+    }
+
+    Counts total = {0};
+    uint64_t bytes = 0;
+    double start = nowMs();
+    for (; argi < argc; argi++) {
+        MappedFile file;
+        if (!mapFile(&file, argv[argi])) {
+            printf("Cannot open %s\n", argv[argi]);
+            continue;
+        }
+        const char *text = (const char *)file.data;
+        size_t starts[MAX_THREADS + 1];
+        int pieces = pgnSplit(text, file.size, threadCount, starts);
+
+        static Counts counts[MAX_THREADS];
+        pthread_t threads[MAX_THREADS];
+        for (int i = 0; i < pieces; i++) {
+            counts[i] = (Counts){.text = text + starts[i], .length = starts[i + 1] - starts[i]};
+            pthread_create(&threads[i], NULL, parseWorker, &counts[i]);
+        }
+        for (int i = 0; i < pieces; i++) {
+            pthread_join(threads[i], NULL);
+            Counts *c = &counts[i];
+            total.games += c->games, total.moves += c->moves, total.tags += c->tags;
+            total.comments += c->comments, total.nags += c->nags, total.variations += c->variations;
+            total.dropped += c->dropped, total.illegal += c->illegal;
+            for (int r = 0; r < 4; r++) total.results[r] += c->results[r];
+        }
+        bytes += file.size;
+        unmapFile(&file);
+    }
+    double seconds = (nowMs() - start) / 1000.0;
+
+    printf("Games:      %llu (1-0 %llu, 0-1 %llu, 1/2 %llu, unknown %llu)\n", (unsigned long long)total.games,
+           (unsigned long long)total.results[PGN_WHITE_WINS], (unsigned long long)total.results[PGN_BLACK_WINS],
+           (unsigned long long)total.results[PGN_DRAW], (unsigned long long)total.results[PGN_UNKNOWN]);
+    printf("Moves:      %llu (%llu past %d plies dropped)\n", (unsigned long long)total.moves,
+           (unsigned long long)total.dropped, PGN_MAX_PLIES);
+    printf("Tags:       %llu\n", (unsigned long long)total.tags);
+    printf("Comments:   %llu, NAGs %llu, variations %llu\n", (unsigned long long)total.comments,
+           (unsigned long long)total.nags, (unsigned long long)total.variations);
+    if (replay) printf("Unreadable: %llu games\n", (unsigned long long)total.illegal);
+    printf("Parsed %.1f MB in %.3f s (%.1f MB/s)\n", bytes / 1048576.0, seconds, bytes / 1048576.0 / (seconds + 1e-9));
+    return 0;
+}
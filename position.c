@@ -0,0 +1,356 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "position.h"
+#include "evaluate.h"
+
+const char typeChars[6] = {'P', 'N', 'B', 'R', 'Q', 'K'};
+
+// ------------------ ZOBRIST KEYS ------------------
+static uint64_t pieceKeys[2][6][64];
+static uint64_t castlingKeys[16];
+static uint64_t epFileKeys[8];
+static uint64_t sideKey;
+static uint64_t materialKeys[2][6][16]; // [color][type][n]: the n-th piece of its kind
+
+// xorshift64*, fixed seed so keys are identical between runs
+static uint64_t nextRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+void initZobrist(void) {
+    uint64_t state = 1070372;
+    for (int c = WHITE; c <= BLACK; c++)
+        for (int t = PAWN; t <= KING; t++)
+            for (int sq = 0; sq < 64; sq++) pieceKeys[c][t][sq] = nextRandom(&state);
+    for (int i = 0; i < 16; i++) castlingKeys[i] = nextRandom(&state);
+    for (int f = 0; f < 8; f++) epFileKeys[f] = nextRandom(&state);
+    sideKey = nextRandom(&state);
+    for (int c = WHITE; c <= BLACK; c++)
+        for (int t = PAWN; t <= KING; t++)
+            for (int n = 0; n < 16; n++) materialKeys[c][t][n] = nextRandom(&state);
+}
+
+// Rights lost when a move starts or ends on the square: the king squares
+// drop both of their side's rights, the corner squares one each
+static const unsigned char castlingLost[64] = {
+    [0] = WHITE_OOO, [4] = WHITE_OO | WHITE_OOO, [7] = WHITE_OO,
+    [56] = BLACK_OOO, [60] = BLACK_OO | BLACK_OOO, [63] = BLACK_OO,
+};
+
+// Full recomputation of the key, used to set it up and to verify it
+uint64_t computeKey(const Position *pos) {
+    uint64_t key = 0;
+    for (int c = WHITE; c <= BLACK; c++) {
+        for (int t = PAWN; t <= KING; t++) {
+            Bitboard b = pos->pieces[c][t];
+            while (b) key ^= pieceKeys[c][t][popLsb(&b)];
+        }
+    }
+    key ^= castlingKeys[pos->castling];
+    if (pos->epSquare != NO_SQUARE) key ^= epFileKeys[squareCol(pos->epSquare)];
+    if (pos->sideToMove == BLACK) key ^= sideKey;
+    return key;
+}
+
+uint64_t computePawnKey(const Position *pos) {
+    uint64_t key = 0;
+    for (int c = WHITE; c <= BLACK; c++) {
+        Bitboard b = pos->pieces[c][PAWN];
+        while (b) key ^= pieceKeys[c][PAWN][popLsb(&b)];
+    }
+    return key;
+}
+
+// Depends only on how many pieces of each kind are on the board
+uint64_t computeMaterialKey(const Position *pos) {
+    int counts[2][6];
+    for (int c = WHITE; c <= BLACK; c++) {
+        for (int t = PAWN; t <= KING; t++) counts[c][t] = popCount(pos->pieces[c][t]);
+    }
+    return materialKeyOf(counts);
+}
+
+// The material key of any position with these [color][type] piece counts
+uint64_t materialKeyOf(const int counts[2][6]) {
+    uint64_t key = 0;
+    for (int c = WHITE; c <= BLACK; c++) {
+        for (int t = PAWN; t <= KING; t++) {
+            for (int n = 1; n <= counts[c][t] && n < 16; n++) key ^= materialKeys[c][t][n];
+        }
+    }
+    return key;
+}
+
+// Debug consistency check: the incremental keys and evaluation terms must
+// match a recomputation and the mailbox must agree with the bitboards
+int checkPosition(const Position *pos) {
+    int psq[2] = {0, 0}, material[2] = {0, 0}, phase = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        Piece p = pos->board[sq];
+        if (p == NO_PIECE ? (pos->occupied & SQUARE_BB(sq)) != 0
+                          : !(pos->pieces[pieceColor(p)][pieceType(p)] & SQUARE_BB(sq))) return 0;
+        if (p == NO_PIECE) continue;
+        psq[MG] += psqScore(MG, pieceColor(p), pieceType(p), sq);
+        psq[EG] += psqScore(EG, pieceColor(p), pieceType(p), sq);
+        material[pieceColor(p)] += pieceValue[pieceType(p)];
+        phase += phaseWeight[pieceType(p)];
+    }
+    if (psq[MG] != pos->psq[MG] || psq[EG] != pos->psq[EG] || material[WHITE] != pos->material[WHITE] ||
+        material[BLACK] != pos->material[BLACK] || phase != pos->phase) return 0;
+    return pos->key == computeKey(pos) && pos->pawnKey == computePawnKey(pos) &&
+           pos->materialKey == computeMaterialKey(pos);
+}
+
+#ifdef DEBUG_POSITION
+#include <assert.h>
+#define DEBUG_CHECK(pos) assert(checkPosition(pos))
+#else
+#define DEBUG_CHECK(pos) ((void)0)
+#endif
+
+// En passant only counts when an enemy pawn could actually capture, so
+// positions that differ in nothing else share a key
+static int epSquareIfCapturable(const Position *pos, int sq, int capturer) {
+    return (pawnAttacks[!capturer][sq] & pos->pieces[capturer][PAWN]) ? sq : NO_SQUARE;
+}
+
+// Whether the king of 'color' stands attacked by the other side
+static int kingAttacked(const Position *pos, int color) {
+    int ksq = lsb(pos->pieces[color][KING]);
+    const Bitboard *them = pos->pieces[!color];
+    return (pawnAttacks[color][ksq] & them[PAWN]) || (knightAttacks[ksq] & them[KNIGHT]) ||
+           (kingAttacks[ksq] & them[KING]) || (bishopAttacks(ksq, pos->occupied) & (them[BISHOP] | them[QUEEN])) ||
+           (rookAttacks(ksq, pos->occupied) & (them[ROOK] | them[QUEEN]));
+}
+
+int colorIndex(char color) {
+    return color == 'w' ? WHITE : BLACK;
+}
+
+char colorChar(int color) {
+    return color == WHITE ? 'w' : 'b';
+}
+
+int typeIndex(char type) {
+    switch (type) {
+        case 'P': return PAWN;
+        case 'N': return KNIGHT;
+        case 'B': return BISHOP;
+        case 'R': return ROOK;
+        case 'Q': return QUEEN;
+        case 'K': return KING;
+    }
+    return -1;
+}
+
+void initPosition(Position *pos) {
+    setPositionFromFEN(pos, START_FEN);
+}
+
+// Loads the placement, side, castling and en passant fields of a FEN string.
+// Returns 0 on malformed input, when a side has no king or several, or when
+// the side not to move is in check.
+int setPositionFromFEN(Position *pos, const char *fen) {
+    memset(pos, 0, sizeof(*pos));
+    pos->epSquare = NO_SQUARE;
+
+    int rank = 7, file = 0;
+    for (; *fen && *fen != ' '; fen++) {
+        if (*fen == '/') {
+            rank--;
+            file = 0;
+        } else if (isdigit((unsigned char)*fen)) {
+            file += *fen - '0';
+        } else {
+            int type = typeIndex((char)toupper((unsigned char)*fen));
+            if (type < 0 || rank < 0 || file > 7) return 0;
+            putPiece(pos, isupper((unsigned char)*fen) ? WHITE : BLACK, type, rank * 8 + file);
+            file++;
+        }
+    }
+    if (*fen++ != ' ') return 0;
+    pos->sideToMove = (*fen == 'b') ? BLACK : WHITE;
+    fen++;
+
+    // A right named by the castling field only counts when its king and
+    // rook still stand on their home squares
+    while (*fen == ' ') fen++;
+    for (; *fen && *fen != ' '; fen++) {
+        int color = isupper((unsigned char)*fen) ? WHITE : BLACK;
+        int kingSq = color == WHITE ? 4 : 60;
+        int right = 0, rookSq = 0;
+        switch (toupper((unsigned char)*fen)) {
+            case 'K': right = color == WHITE ? WHITE_OO : BLACK_OO; rookSq = kingSq + 3; break;
+            case 'Q': right = color == WHITE ? WHITE_OOO : BLACK_OOO; rookSq = kingSq - 4; break;
+        }
+        if (right && pos->board[kingSq] == makePiece(color, KING) && pos->board[rookSq] == makePiece(color, ROOK))
+            pos->castling |= right;
+    }
+
+    while (*fen == ' ') fen++;
+    if (fen[0] >= 'a' && fen[0] <= 'h' && fen[1] >= '1' && fen[1] <= '8') {
+        pos->epSquare = epSquareIfCapturable(pos, (fen[1] - '1') * 8 + (fen[0] - 'a'), pos->sideToMove);
+    }
+    while (*fen && *fen != ' ') fen++;
+    while (*fen == ' ') fen++;
+    pos->halfmoveClock = atoi(fen);
+    pos->key = computeKey(pos);
+
+    // Only positions a game can reach: one king a side, and the side that
+    // just moved not left in check
+    if (popCount(pos->pieces[WHITE][KING]) != 1 || popCount(pos->pieces[BLACK][KING]) != 1) return 0;
+    return !kingAttacked(pos, !pos->sideToMove);
+}
+
+void putPiece(Position *pos, int color, int type, int sq) {
+    Bitboard bb = SQUARE_BB(sq);
+    pos->pieces[color][type] |= bb;
+    pos->byColor[color] |= bb;
+    pos->occupied |= bb;
+    pos->board[sq] = makePiece(color, type);
+    pos->key ^= pieceKeys[color][type][sq];
+    if (type == PAWN) pos->pawnKey ^= pieceKeys[color][PAWN][sq];
+    pos->materialKey ^= materialKeys[color][type][popCount(pos->pieces[color][type])];
+    pos->psq[MG] += psqScore(MG, color, type, sq);
+    pos->psq[EG] += psqScore(EG, color, type, sq);
+    pos->material[color] += pieceValue[type];
+    pos->phase += phaseWeight[type];
+}
+
+void removePiece(Position *pos, int sq) {
+    Piece p = pos->board[sq];
+    if (p == NO_PIECE) return;
+    Bitboard bb = SQUARE_BB(sq);
+    int c = pieceColor(p), type = pieceType(p);
+    pos->materialKey ^= materialKeys[c][type][popCount(pos->pieces[c][type])];
+    pos->pieces[c][type] &= ~bb;
+    pos->byColor[c] &= ~bb;
+    pos->occupied &= ~bb;
+    pos->board[sq] = NO_PIECE;
+    pos->key ^= pieceKeys[c][type][sq];
+    if (type == PAWN) pos->pawnKey ^= pieceKeys[c][PAWN][sq];
+    pos->psq[MG] -= psqScore(MG, c, type, sq);
+    pos->psq[EG] -= psqScore(EG, c, type, sq);
+    pos->material[c] -= pieceValue[type];
+    pos->phase -= phaseWeight[type];
+}
+
+Piece pieceAt(const Position *pos, int row, int col) {
+    return pos->board[makeSquare(row, col)];
+}
+
+// Coordinate notation such as "e2e4" or "e7e8q"; buf needs 6 bytes
+void moveToString(Move move, char *buf) {
+    int from = moveFrom(move), to = moveTo(move);
+    buf[0] = (char)('a' + (from & 7));
+    buf[1] = (char)('1' + (from >> 3));
+    buf[2] = (char)('a' + (to & 7));
+    buf[3] = (char)('1' + (to >> 3));
+    buf[4] = moveFlag(move) == MOVE_PROMOTION ? (char)tolower(typeChars[movePromotion(move)]) : '\0';
+    buf[5] = '\0';
+}
+
+// ------------------ MAKE / UNMAKE ------------------
+// Where the rook of a castling move (encoded king from, king to) starts and ends
+void castlingRookSquares(Move move, int *rookFrom, int *rookTo) {
+    int from = moveFrom(move), to = moveTo(move);
+    *rookFrom = (to > from) ? from + 3 : from - 4;
+    *rookTo = (to > from) ? from + 1 : from - 1;
+}
+
+void makeMove(Position *pos, Move move, StateInfo *st) {
+    int us = pos->sideToMove;
+    int from = moveFrom(move), to = moveTo(move);
+    int flag = moveFlag(move);
+    int type = pieceTypeOn(pos, from);
+    int capSq = (flag == MOVE_EN_PASSANT) ? to - ((us == WHITE) ? 8 : -8) : to;
+
+    st->castling = (unsigned char)pos->castling;
+    st->key = pos->key;
+    st->halfmoveClock = pos->halfmoveClock;
+    st->epSquare = (signed char)pos->epSquare;
+    st->captured = (signed char)pieceTypeOn(pos, capSq);
+
+    if (st->captured >= 0) removePiece(pos, capSq);
+    removePiece(pos, from);
+    putPiece(pos, us, flag == MOVE_PROMOTION ? movePromotion(move) : type, to);
+
+    if (flag == MOVE_CASTLING) {
+        int rookFrom, rookTo;
+        castlingRookSquares(move, &rookFrom, &rookTo);
+        removePiece(pos, rookFrom);
+        putPiece(pos, us, ROOK, rookTo);
+    }
+
+    pos->halfmoveClock = (type == PAWN || st->captured >= 0) ? 0 : pos->halfmoveClock + 1;
+    if (pos->epSquare != NO_SQUARE) pos->key ^= epFileKeys[squareCol(pos->epSquare)];
+    pos->epSquare = NO_SQUARE;
+    if (type == PAWN && (to - from == 16 || from - to == 16)) {
+        pos->epSquare = epSquareIfCapturable(pos, (from + to) / 2, !us);
+        if (pos->epSquare != NO_SQUARE) pos->key ^= epFileKeys[squareCol(pos->epSquare)];
+    }
+    int lost = pos->castling & (castlingLost[from] | castlingLost[to]);
+    if (lost) {
+        pos->key ^= castlingKeys[pos->castling] ^ castlingKeys[pos->castling ^ lost];
+        pos->castling ^= lost;
+    }
+    pos->key ^= sideKey;
+    pos->sideToMove = !us;
+    DEBUG_CHECK(pos);
+}
+
+void unmakeMove(Position *pos, Move move, const StateInfo *st) {
+    int us = !pos->sideToMove;
+    int from = moveFrom(move), to = moveTo(move);
+    int flag = moveFlag(move);
+    int type = (flag == MOVE_PROMOTION) ? PAWN : pieceTypeOn(pos, to);
+
+    if (flag == MOVE_CASTLING) {
+        int rookFrom, rookTo;
+        castlingRookSquares(move, &rookFrom, &rookTo);
+        removePiece(pos, rookTo);
+        putPiece(pos, us, ROOK, rookFrom);
+    }
+    removePiece(pos, to);
+    putPiece(pos, us, type, from);
+    if (st->captured >= 0) {
+        int capSq = (flag == MOVE_EN_PASSANT) ? to - ((us == WHITE) ? 8 : -8) : to;
+        putPiece(pos, !us, st->captured, capSq);
+    }
+
+    pos->castling = st->castling;
+    pos->halfmoveClock = st->halfmoveClock;
+    pos->epSquare = st->epSquare;
+    pos->sideToMove = us;
+    pos->key = st->key;
+    DEBUG_CHECK(pos);
+}
+
+// Passes the turn without moving, for null-move pruning. Never call it in
+// check: the side that passed would be able to take the king.
+void makeNullMove(Position *pos, StateInfo *st) {
+    st->castling = (unsigned char)pos->castling;
+    st->key = pos->key;
+    st->halfmoveClock = pos->halfmoveClock;
+    st->epSquare = (signed char)pos->epSquare;
+    st->captured = -1;
+
+    if (pos->epSquare != NO_SQUARE) pos->key ^= epFileKeys[squareCol(pos->epSquare)];
+    pos->epSquare = NO_SQUARE;
+    pos->halfmoveClock++;
+    pos->key ^= sideKey;
+    pos->sideToMove = !pos->sideToMove;
+    DEBUG_CHECK(pos);
+}
+
+void unmakeNullMove(Position *pos, const StateInfo *st) {
+    pos->halfmoveClock = st->halfmoveClock;
+    pos->epSquare = st->epSquare;
+    pos->sideToMove = !pos->sideToMove;
+    pos->key = st->key;
+    DEBUG_CHECK(pos);
+}
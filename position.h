@@ -0,0 +1,97 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include "bitboard.h"
+
+enum { WHITE, BLACK };
+enum { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+
+#define NO_SQUARE 64
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// ------------------ STRUCT DEFINITIONS ------------------
+// One byte per piece: color in bit 3, type + 1 in bits 0-2, 0 on an empty square
+typedef uint8_t Piece;
+
+#define NO_PIECE 0
+#define makePiece(color, type) ((Piece)(((color) << 3) | ((type) + 1)))
+#define pieceType(p) (((p) & 7) - 1) // -1 for NO_PIECE
+#define pieceColor(p) ((p) >> 3)
+
+// Packed move: bits 0-5 from, 6-11 to, 12-13 promotion piece, 14-15 flag
+typedef uint16_t Move;
+
+enum { MOVE_NORMAL, MOVE_PROMOTION, MOVE_EN_PASSANT, MOVE_CASTLING };
+
+#define MOVE_NONE 0
+#define moveFrom(m) ((m) & 63)
+#define moveTo(m) (((m) >> 6) & 63)
+#define movePromotion(m) ((((m) >> 12) & 3) + KNIGHT)
+#define moveFlag(m) ((m) >> 14)
+
+static inline Move encodeMove(int from, int to, int flag, int promotion) {
+    return (Move)(from | (to << 6) | ((promotion - KNIGHT) << 12) | (flag << 14));
+}
+
+// Irreversible state saved by makeMove so unmakeMove can restore it. Callers
+// keep these in a preallocated per-ply array.
+typedef struct {
+    uint64_t key;
+    int halfmoveClock;
+    signed char epSquare;
+    signed char captured; // Captured piece type, or -1
+    unsigned char castling;
+} StateInfo;
+
+// Authoritative board state: one set per piece type and color plus occupancy,
+// mirrored by a one-byte-per-square mailbox for "what stands here" lookups
+typedef struct {
+    Bitboard pieces[2][6]; // [color][type]
+    Bitboard byColor[2];
+    Bitboard occupied;
+    Piece board[64];       // Indexed by square, NO_PIECE when empty
+    int castling;          // Castling rights still held, see below
+    int sideToMove;        // WHITE or BLACK
+    int epSquare;          // Square behind a pawn that just moved two, or NO_SQUARE
+    int halfmoveClock;     // Plies since the last capture or pawn move
+    uint64_t key;          // Zobrist hash, maintained incrementally
+    uint64_t pawnKey;      // Zobrist hash of the pawns alone, likewise
+    uint64_t materialKey;  // Hash of the piece counts alone, likewise
+    int psq[2];            // Material and square bonuses, White minus Black, [MG] and [EG]
+    int material[2];       // Piece values per color, king excluded
+    int phase;             // Sum of phaseWeight over the board, see evaluate.h
+} Position;
+
+// Castling rights bits as hashed into the key
+enum { WHITE_OO = 1, WHITE_OOO = 2, BLACK_OO = 4, BLACK_OOO = 8 };
+#define ALL_CASTLING 15
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+void initZobrist(void);
+void initPosition(Position *pos);
+int setPositionFromFEN(Position *pos, const char *fen);
+Piece pieceAt(const Position *pos, int row, int col);
+void putPiece(Position *pos, int color, int type, int sq);
+void removePiece(Position *pos, int sq);
+void makeMove(Position *pos, Move move, StateInfo *st);
+void unmakeMove(Position *pos, Move move, const StateInfo *st);
+void castlingRookSquares(Move move, int *rookFrom, int *rookTo);
+void makeNullMove(Position *pos, StateInfo *st);
+void unmakeNullMove(Position *pos, const StateInfo *st);
+void moveToString(Move move, char *buf);
+
+static inline int pieceTypeOn(const Position *pos, int sq) {
+    return pieceType(pos->board[sq]);
+}
+uint64_t computeKey(const Position *pos);
+uint64_t computePawnKey(const Position *pos);
+uint64_t computeMaterialKey(const Position *pos);
+uint64_t materialKeyOf(const int counts[2][6]);
+int checkPosition(const Position *pos);
+int colorIndex(char color);
+char colorChar(int color);
+int typeIndex(char type);
+
+extern const char typeChars[6];
+
+#endif
@@ -0,0 +1,527 @@
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "search.h"
+#include "evaluate.h"
+#include "nnue.h"
+#include "syzygy.h"
+#include "timer.h"
+#include "tt.h"
+
+// ------------------ OPTIONS ------------------
+SearchOptions searchOptions = {1, 1, 1, 1, 1, 1, 1};
+
+// Switches one refinement by name; returns 0 if there is no such option
+int setSearchOption(const char *name, int enabled) {
+    static const struct {
+        const char *name;
+        size_t offset;
+    } names[] = {
+        {"pvs", offsetof(SearchOptions, pvs)},
+        {"aspiration", offsetof(SearchOptions, aspiration)},
+        {"nullmove", offsetof(SearchOptions, nullMove)},
+        {"lmr", offsetof(SearchOptions, lmr)},
+        {"rfp", offsetof(SearchOptions, reverseFutility)},
+        {"futility", offsetof(SearchOptions, futility)},
+        {"matedistance", offsetof(SearchOptions, mateDistance)},
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i].name) == 0) {
+            *(int *)((char *)&searchOptions + names[i].offset) = enabled != 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ------------------ LIMITS ------------------
+static int stopped(const SearchThread *t) {
+    return atomic_load_explicit(&t->pool->stop, memory_order_relaxed);
+}
+
+// Single writer, so a plain load and store is enough and avoids a locked add
+static uint64_t countNode(SearchThread *t) {
+    uint64_t n = atomic_load_explicit(&t->nodes, memory_order_relaxed) + 1;
+    atomic_store_explicit(&t->nodes, n, memory_order_relaxed);
+    return n;
+}
+
+static uint64_t totalNodes(const SearchPool *pool) {
+    uint64_t n = 0;
+    for (int i = 0; i < pool->count; i++) n += atomic_load_explicit(&pool->threads[i].nodes, memory_order_relaxed);
+    return n;
+}
+
+// Polled by the main thread every 1024 of its nodes; helpers only follow the
+// stop flag. The node budget counts every thread's nodes.
+static void checkLimits(SearchThread *t) {
+    int stop = 0;
+    if (t->limits.nodes && totalNodes(t->pool) >= t->limits.nodes) stop = 1;
+    if (t->limits.timeMs > 0 && nowMs() - t->startMs >= t->limits.timeMs) stop = 1;
+    if (stop) stopSearch(t->pool);
+}
+
+// ------------------ DRAWS ------------------
+// Fifty-move rule, or the current position already occurred since the last
+// irreversible move (a single repetition is enough inside the search)
+static int isDraw(const SearchThread *t) {
+    const Position *pos = &t->pos;
+    if (pos->halfmoveClock >= 100) return 1;
+    int oldest = t->keyCount - 1 - pos->halfmoveClock;
+    if (oldest < 0) oldest = 0;
+    for (int i = t->keyCount - 3; i >= oldest; i -= 2) {
+        if (t->keys[i] == pos->key) return 1;
+    }
+    return 0;
+}
+
+// ------------------ HASH SCORES ------------------
+// Mate scores are stored relative to the node rather than the root, so an
+// entry stays right when the position is reached at another ply
+static int scoreToTT(int score, int ply) {
+    return score > MATE_BOUND ? score + ply : score < -MATE_BOUND ? score - ply : score;
+}
+
+static int scoreFromTT(int score, int ply) {
+    return score > MATE_BOUND ? score - ply : score < -MATE_BOUND ? score + ply : score;
+}
+
+// ------------------ MOVE ORDERING ------------------
+// A quiet move that cut off becomes this ply's first killer, and its history
+// rises while the quiet moves tried before it, which failed, sink
+static void updateQuietStats(SearchThread *t, Move move, const Move *failed, int failedCount, int depth, int ply) {
+    int us = t->pos.sideToMove;
+    if (t->killers[ply][0] != move) {
+        t->killers[ply][1] = t->killers[ply][0];
+        t->killers[ply][0] = move;
+    }
+    int bonus = depth * depth;
+    updateHistory(&t->history, us, move, bonus);
+    for (int i = 0; i < failedCount; i++) updateHistory(&t->history, us, failed[i], -bonus);
+}
+
+// ------------------ EVALUATION ------------------
+// The network when one is loaded, the piece-square evaluation otherwise
+static int evaluateNode(SearchThread *t, int ply) {
+    return nnueLoaded() ? nnueEvaluate(&t->pos, &t->acc[ply]) : evaluate(&t->pos, &t->pawns, &t->material);
+}
+
+// ------------------ QUIESCENCE ------------------
+#define DELTA_MARGIN 200 // Positional swing a capture may add beyond its material
+
+// Resolves captures until the position is quiet, so the horizon never cuts
+// an exchange in half. The side to move may stand pat on the static score
+// instead of capturing; in check every evasion is searched.
+static int quiescence(SearchThread *t, int alpha, int beta, int ply) {
+    Position *pos = &t->pos;
+    t->pvLength[ply] = 0;
+    if ((countNode(t) & 1023) == 0 && t->id == 0) checkLimits(t);
+    if (stopped(t)) return 0;
+    if (isDraw(t)) return 0;
+    if (ply >= MAX_PLY - 1) return evaluateNode(t, ply);
+
+    TTData tte;
+    Move ttMove = MOVE_NONE;
+    if (ttProbe(pos->key, &tte)) {
+        ttMove = tte.move;
+        int ttScore = scoreFromTT(tte.score, ply);
+        if (tte.bound == BOUND_EXACT || (tte.bound == BOUND_LOWER && ttScore >= beta) ||
+            (tte.bound == BOUND_UPPER && ttScore <= alpha)) {
+            return ttScore;
+        }
+    }
+
+    int inCheck = isInCheck(pos, pos->sideToMove);
+    int standPat = -INFINITE_SCORE;
+    if (!inCheck) {
+        standPat = evaluateNode(t, ply);
+        if (standPat >= beta) return standPat;
+        if (standPat > alpha) alpha = standPat;
+    }
+
+    MovePicker mp;
+    if (inCheck) initMovePicker(&mp, pos, ttMove, t->killers[ply], &t->history);
+    else initQuiescencePicker(&mp, pos, ttMove);
+
+    int alphaOrig = alpha;
+    int best = standPat;
+    Move bestMove = MOVE_NONE;
+    int moveCount = 0;
+    Move move;
+    while ((move = nextMove(&mp)) != MOVE_NONE) {
+        moveCount++;
+        if (!inCheck) {
+            // Underpromotions only matter in rare quiet lines
+            if (moveFlag(move) == MOVE_PROMOTION && movePromotion(move) != QUEEN) continue;
+            // Delta pruning: even winning the piece outright would not
+            // bring the score up to alpha
+            int victim = moveFlag(move) == MOVE_EN_PASSANT ? PAWN : pieceTypeOn(pos, moveTo(move));
+            if (moveFlag(move) != MOVE_PROMOTION && victim >= 0 &&
+                standPat + pieceValue[victim] + DELTA_MARGIN <= alpha) continue;
+        }
+
+        nnuePush(&t->acc[ply + 1], pos, move);
+        makeMove(pos, move, &t->states[ply]);
+        ttPrefetch(pos->key);
+        t->keys[t->keyCount++] = pos->key;
+        int score = -quiescence(t, -beta, -alpha, ply + 1);
+        t->keyCount--;
+        unmakeMove(pos, move, &t->states[ply]);
+        if (stopped(t)) return 0;
+
+        if (score > best) {
+            best = score;
+            bestMove = move;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+    if (inCheck && moveCount == 0) return -MATE_SCORE + ply;
+
+    int bound = best >= beta ? BOUND_LOWER : best > alphaOrig ? BOUND_EXACT : BOUND_UPPER;
+    ttStore(pos->key, bestMove, scoreToTT(best, ply), inCheck ? SCORE_NONE : standPat, 0, bound);
+    return best;
+}
+
+// ------------------ ALPHA-BETA ------------------
+#define RFP_MARGIN 80          // Reverse futility: eval surplus over beta needed per ply
+#define FUTILITY_BASE 100      // Futility: what a quiet move may gain at depth 0...
+#define FUTILITY_MARGIN 120    // ...plus this per ply of remaining depth
+#define NULL_VERIFY_DEPTH 10   // Null-move cutoffs this deep are verified
+
+// Pieces other than pawns and king. With none, passing is often the best
+// move (zugzwang), which would make a null-move cutoff a lie.
+static int hasNonPawnMaterial(const Position *pos, int color) {
+    return (pos->pieces[color][KNIGHT] | pos->pieces[color][BISHOP] | pos->pieces[color][ROOK] |
+            pos->pieces[color][QUEEN]) != 0;
+}
+
+static int floorLog2(int n) {
+    return 31 - __builtin_clz((unsigned)n);
+}
+
+// Late moves are searched shallower, more so the deeper the node and the
+// later the move; a reduced move that beats alpha is searched again in full
+static int lmrReduction(int depth, int moveCount) {
+    return 1 + floorLog2(depth) * floorLog2(moveCount) / 3;
+}
+
+static int negamax(SearchThread *t, int alpha, int beta, int depth, int ply) {
+    Position *pos = &t->pos;
+    if (depth <= 0) return quiescence(t, alpha, beta, ply);
+    t->pvLength[ply] = 0;
+    if ((countNode(t) & 1023) == 0 && t->id == 0) checkLimits(t);
+    if (stopped(t)) return 0;
+    if (ply > 0 && isDraw(t)) return 0;
+    if (ply >= MAX_PLY - 1) return evaluateNode(t, ply);
+
+    // Without PVS almost every window is open, so only the root is treated
+    // as a PV node, as before PVS
+    const SearchOptions *opt = &searchOptions;
+    int pvNode = opt->pvs ? beta - alpha > 1 : ply == 0;
+
+    // Mate distance pruning: a mate found nearer the root already beats
+    // anything this node can return
+    if (opt->mateDistance && ply > 0) {
+        if (alpha < -MATE_SCORE + ply) alpha = -MATE_SCORE + ply;
+        if (beta > MATE_SCORE - ply - 1) beta = MATE_SCORE - ply - 1;
+        if (alpha >= beta) return alpha;
+    }
+
+    // A deep enough stored result whose bound settles this window ends the
+    // node, except on the principal variation, which must come back whole;
+    // otherwise its move is still the best first guess
+    TTData tte;
+    int ttHit = ttProbe(pos->key, &tte);
+    Move ttMove = MOVE_NONE;
+    if (ttHit) {
+        ttMove = tte.move;
+        int ttScore = scoreFromTT(tte.score, ply);
+        if (!pvNode && tte.depth >= depth &&
+            (tte.bound == BOUND_EXACT || (tte.bound == BOUND_LOWER && ttScore >= beta) ||
+             (tte.bound == BOUND_UPPER && ttScore <= alpha))) {
+            return ttScore;
+        }
+    }
+
+    // Tablebase: the exact outcome, probed just after a capture or pawn move
+    // brings the position into the tables, so each is probed once per line
+    if (ply > 0 && syzygyMaxPieces && pos->halfmoveClock == 0 && !pos->castling &&
+        popCount(pos->occupied) <= syzygyMaxPieces) {
+        int found, wdl = syzygyProbeWdl(pos, &found);
+        if (found) {
+            t->tbHits++;
+            int score = wdl == TB_WIN ? TB_WIN_SCORE : wdl == TB_LOSS ? -TB_WIN_SCORE : 0;
+            ttStore(pos->key, MOVE_NONE, score, SCORE_NONE, depth + 6, BOUND_EXACT);
+            return score;
+        }
+    }
+
+    int inCheck = isInCheck(pos, pos->sideToMove);
+    int eval = SCORE_NONE;
+    if (!inCheck) eval = (ttHit && tte.eval != SCORE_NONE) ? tte.eval : evaluateNode(t, ply);
+
+    if (!pvNode && !inCheck && beta < MATE_BOUND && beta > -MATE_BOUND) {
+        // Reverse futility: so far above beta that the opponent's best reply
+        // within the remaining plies will not bring it back
+        if (opt->reverseFutility && depth <= 6 && eval - RFP_MARGIN * depth >= beta) return eval;
+
+        // Null move: if passing still leaves us above beta after a reduced
+        // search, a real move would too. Never twice in a row, and not
+        // without pieces, where passing may be the best move there is.
+        if (opt->nullMove && depth >= 3 && eval >= beta && ply >= t->nullMinPly &&
+            (ply == 0 || t->played[ply - 1] != MOVE_NONE) && hasNonPawnMaterial(pos, pos->sideToMove)) {
+            int r = 3 + depth / 6;
+            t->played[ply] = MOVE_NONE;
+            nnuePushNull(&t->acc[ply + 1]);
+            makeNullMove(pos, &t->states[ply]);
+            t->keys[t->keyCount++] = pos->key;
+            int score = -negamax(t, -beta, -beta + 1, depth - 1 - r, ply + 1);
+            t->keyCount--;
+            unmakeNullMove(pos, &t->states[ply]);
+            if (stopped(t)) return 0;
+            if (score >= beta) {
+                if (score >= MATE_BOUND) score = beta; // A mate after passing proves nothing
+                if (depth < NULL_VERIFY_DEPTH) return score;
+                // Deep cutoffs are confirmed by a reduced search without
+                // null moves, which zugzwang cannot fool
+                int savedMinPly = t->nullMinPly;
+                t->nullMinPly = ply + 1 + (depth - r) * 3 / 4;
+                int verified = negamax(t, beta - 1, beta, depth - r, ply);
+                t->nullMinPly = savedMinPly;
+                if (stopped(t)) return 0;
+                if (verified >= beta) return score;
+            }
+        }
+    }
+
+    // Futility: near the leaves, a quiet move cannot lift a static eval this
+    // far below alpha, unless it gives check
+    int futile = opt->futility && !pvNode && !inCheck && depth <= 3 && alpha > -MATE_BOUND &&
+                 eval + FUTILITY_BASE + FUTILITY_MARGIN * depth <= alpha;
+
+    // Without a hash move, last iteration's move for this ply is the guess
+    MovePicker mp;
+    initMovePicker(&mp, pos, ttMove != MOVE_NONE ? ttMove : t->prevPv[ply], t->killers[ply], &t->history);
+
+    int alphaOrig = alpha;
+    int best = -INFINITE_SCORE;
+    Move bestMove = MOVE_NONE;
+    Move quietsTried[MAX_MOVES];
+    int quietCount = 0, moveCount = 0;
+    Move move;
+    while ((move = nextMove(&mp)) != MOVE_NONE) {
+        int quiet = !isCapture(pos, move) && moveFlag(move) != MOVE_PROMOTION;
+        int checks = givesCheck(pos, move);
+        moveCount++;
+        // Decided before the move is made, so a pruned move costs no make/unmake
+        if (futile && quiet && moveCount > 1 && !checks) continue;
+        t->played[ply] = move;
+        nnuePush(&t->acc[ply + 1], pos, move);
+        makeMove(pos, move, &t->states[ply]);
+        ttPrefetch(pos->key);
+        t->keys[t->keyCount++] = pos->key;
+
+        // The first move gets the full window. Later ones only have to be
+        // shown no better than alpha, which a null window does cheaply (PVS),
+        // at reduced depth if they are late quiet moves (LMR); any that turn
+        // out better are searched again properly.
+        int newDepth = depth - 1;
+        int score;
+        if (moveCount == 1) {
+            score = -negamax(t, -beta, -alpha, newDepth, ply + 1);
+        } else {
+            int reduction = 0;
+            if (opt->lmr && depth >= 3 && moveCount > 1 + 2 * pvNode && quiet && !inCheck && !checks) {
+                reduction = lmrReduction(depth, moveCount) - pvNode;
+                if (reduction > newDepth - 1) reduction = newDepth - 1;
+                if (reduction < 0) reduction = 0;
+            }
+            int childBeta = opt->pvs ? -alpha - 1 : -beta;
+            score = -negamax(t, childBeta, -alpha, newDepth - reduction, ply + 1);
+            if (reduction > 0 && score > alpha) score = -negamax(t, childBeta, -alpha, newDepth, ply + 1);
+            if (opt->pvs && score > alpha && score < beta) score = -negamax(t, -beta, -alpha, newDepth, ply + 1);
+        }
+        t->keyCount--;
+        unmakeMove(pos, move, &t->states[ply]);
+        if (stopped(t)) return 0;
+
+        if (score > best) {
+            best = score;
+            bestMove = move;
+            if (score > alpha) {
+                alpha = score;
+                // This move followed by the child's line becomes our line
+                t->pv[ply][0] = move;
+                memcpy(&t->pv[ply][1], t->pv[ply + 1], sizeof(Move) * (size_t)t->pvLength[ply + 1]);
+                t->pvLength[ply] = t->pvLength[ply + 1] + 1;
+                if (alpha >= beta) {
+                    if (quiet) updateQuietStats(t, move, quietsTried, quietCount, depth, ply);
+                    break;
+                }
+            }
+        }
+        if (quiet) quietsTried[quietCount++] = move;
+    }
+    if (moveCount == 0) return inCheck ? -MATE_SCORE + ply : 0;
+
+    int bound = best >= beta ? BOUND_LOWER : best > alphaOrig ? BOUND_EXACT : BOUND_UPPER;
+    ttStore(pos->key, bestMove, scoreToTT(best, ply), eval, depth, bound);
+    return best;
+}
+
+// ------------------ ITERATIVE DEEPENING ------------------
+static void setupThread(SearchThread *t, const Position *pos, const uint64_t *history, int historyCount,
+                        const SearchLimits *limits) {
+    t->pos = *pos;
+    t->limits = *limits;
+    t->startMs = nowMs();
+    atomic_store_explicit(&t->nodes, 0, memory_order_relaxed);
+    memset(t->prevPv, 0, sizeof(t->prevPv));
+    nnueReset(&t->acc[0]);
+    t->pawns.probes = t->pawns.hits = 0;
+    t->material.probes = t->material.hits = 0;
+    t->tbHits = 0;
+    t->nullMinPly = 0;
+    memset(t->killers, 0, sizeof(t->killers));
+    memset(t->history, 0, sizeof(t->history));
+
+    // Positions before the last irreversible move can never repeat
+    int kept = historyCount < pos->halfmoveClock ? historyCount : pos->halfmoveClock;
+    if (kept > MAX_REPETITION_KEYS - 1) kept = MAX_REPETITION_KEYS - 1;
+    memcpy(t->keys, history + historyCount - kept, sizeof(uint64_t) * (size_t)kept);
+    t->keys[kept] = pos->key;
+    t->keyCount = kept + 1;
+}
+
+static int maxDepth(const SearchLimits *limits) {
+    return (limits->depth > 0 && limits->depth < MAX_PLY) ? limits->depth : MAX_PLY - 1;
+}
+
+// Helpers search the same position until told to stop. Odd helpers run one
+// ply ahead of the main thread so the threads spread over different depths
+// and fill the table with results the others can use.
+static void *helperLoop(void *arg) {
+    SearchThread *t = arg;
+    for (int depth = 1 + (t->id & 1); depth <= maxDepth(&t->limits) && !stopped(t); depth++) {
+        negamax(t, -INFINITE_SCORE, INFINITE_SCORE, depth, 0);
+    }
+    return NULL;
+}
+
+// Searches the root in a window around the previous iteration's score, which
+// cuts more than a full window when the score barely moves. A score outside
+// it is only a bound, so the window widens on that side and the search runs
+// again until the score lands inside.
+#define ASPIRATION_WINDOW 25
+#define ASPIRATION_MIN_DEPTH 5
+
+static int aspirationSearch(SearchThread *t, int depth, int previous) {
+    if (!searchOptions.aspiration || depth < ASPIRATION_MIN_DEPTH || previous > MATE_BOUND ||
+        previous < -MATE_BOUND) {
+        return negamax(t, -INFINITE_SCORE, INFINITE_SCORE, depth, 0);
+    }
+    int delta = ASPIRATION_WINDOW;
+    int alpha = previous - delta, beta = previous + delta;
+    for (;;) {
+        int score = negamax(t, alpha, beta, depth, 0);
+        if (stopped(t)) return score;
+        if (score <= alpha) {
+            beta = (alpha + beta) / 2;
+            alpha = score - delta > -INFINITE_SCORE ? score - delta : -INFINITE_SCORE;
+        } else if (score >= beta) {
+            beta = score + delta < INFINITE_SCORE ? score + delta : INFINITE_SCORE;
+        } else {
+            return score;
+        }
+        delta *= 2;
+    }
+}
+
+// Allocates the per-thread state for up to 'threads' threads, the caller's
+// own included. Returns 0 if it cannot.
+int initSearchPool(SearchPool *pool, int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > MAX_SEARCH_THREADS) threads = MAX_SEARCH_THREADS;
+    pool->threads = calloc((size_t)threads, sizeof(SearchThread));
+    pool->count = pool->threads ? threads : 0;
+    atomic_init(&pool->stop, 0);
+    for (int i = 0; i < pool->count; i++) {
+        pool->threads[i].pool = pool;
+        pool->threads[i].id = i;
+    }
+    return pool->threads != NULL;
+}
+
+void freeSearchPool(SearchPool *pool) {
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->count = 0;
+}
+
+// Safe to call from any thread; the search unwinds within a few nodes
+void stopSearch(SearchPool *pool) {
+    atomic_store_explicit(&pool->stop, 1, memory_order_relaxed);
+}
+
+// Searches 'pos' one ply deeper at a time until a limit is hit, and reports
+// the deepest iteration the main thread completed. 'history' lists the keys
+// of the positions before this one, oldest first, so repetitions of the game
+// count as draws.
+void searchPosition(SearchPool *pool, const Position *pos, const uint64_t *history, int historyCount,
+                    const SearchLimits *limits, SearchResult *result) {
+    SearchThread *t = &pool->threads[0];
+    atomic_store(&pool->stop, 0);
+    ttNewSearch();
+    for (int i = 0; i < pool->count; i++) setupThread(&pool->threads[i], pos, history, historyCount, limits);
+
+    Move moves[MAX_MOVES];
+    int count = generateLegalMoves(pos, moves);
+    memset(result, 0, sizeof(*result));
+    result->bestMove = count > 0 ? moves[0] : MOVE_NONE; // Fallback if stopped at once
+    if (count == 0) {
+        result->score = isInCheck(pos, pos->sideToMove) ? -MATE_SCORE : 0;
+        return;
+    }
+
+    // A helper that fails to start just leaves the others more work
+    pthread_t helpers[MAX_SEARCH_THREADS];
+    int started[MAX_SEARCH_THREADS] = {0};
+    for (int i = 1; i < pool->count; i++) {
+        started[i] = pthread_create(&helpers[i], NULL, helperLoop, &pool->threads[i]) == 0;
+    }
+
+    for (int depth = 1; depth <= maxDepth(limits); depth++) {
+        int score = aspirationSearch(t, depth, result->score);
+        if (stopped(t)) break;
+
+        result->bestMove = t->pv[0][0];
+        result->score = score;
+        result->depth = depth;
+        result->pvLength = t->pvLength[0];
+        memcpy(result->pv, t->pv[0], sizeof(Move) * (size_t)t->pvLength[0]);
+        memcpy(t->prevPv, t->pv[0], sizeof(Move) * (size_t)t->pvLength[0]);
+
+        // A forced mate will not change with depth, and an iteration that
+        // took half the budget leaves too little for the next one
+        if (score > MATE_BOUND || score < -MATE_BOUND) break;
+        if (limits->timeMs > 0 && nowMs() - t->startMs > limits->timeMs / 2) break;
+    }
+
+    stopSearch(pool);
+    for (int i = 1; i < pool->count; i++) {
+        if (started[i]) pthread_join(helpers[i], NULL);
+    }
+    result->nodes = totalNodes(pool);
+    for (int i = 0; i < pool->count; i++) {
+        result->pawnProbes += pool->threads[i].pawns.probes;
+        result->pawnHits += pool->threads[i].pawns.hits;
+        result->materialProbes += pool->threads[i].material.probes;
+        result->materialHits += pool->threads[i].material.hits;
+        result->tbHits += pool->threads[i].tbHits;
+    }
+    result->timeMs = nowMs() - t->startMs;
+}
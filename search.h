@@ -0,0 +1,99 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdatomic.h>
+#include "movepick.h"
+#include "nnue.h"
+#include "pawns.h"
+#include "material.h"
+
+#define MAX_PLY 64
+#define INFINITE_SCORE 32001
+#define MATE_SCORE 32000
+#define MATE_BOUND (MATE_SCORE - MAX_PLY) // Scores beyond this are forced mates
+#define TB_WIN_SCORE (MATE_BOUND - MAX_PLY) // Tablebase win: above any evaluation, below any mate
+#define SCORE_NONE (-32767)               // No static evaluation stored
+#define MAX_REPETITION_KEYS 128           // Earlier positions kept for repetition checks
+#define MAX_SEARCH_THREADS 256
+
+// ------------------ STRUCT DEFINITIONS ------------------
+// Zero in any field means no limit on it
+typedef struct {
+    int depth;       // Deepest iteration to start
+    double timeMs;   // Wall-clock budget for the whole search
+    uint64_t nodes;  // Node budget
+} SearchLimits;
+
+typedef struct {
+    Move bestMove;   // MOVE_NONE when the side to move has no legal move
+    int score;       // Centipawns for the side to move, or +-(MATE_SCORE - plies)
+    int depth;       // Last iteration that completed
+    uint64_t nodes;
+    double timeMs;
+    Move pv[MAX_PLY];
+    int pvLength;
+    uint64_t pawnProbes, pawnHits; // Pawn cache lookups over all threads
+    uint64_t materialProbes, materialHits; // Material cache lookups, likewise
+    uint64_t tbHits;                 // Tablebase probes that answered, likewise
+} SearchResult;
+
+// Search refinements, each of which can be switched off on its own so its
+// effect on node counts and time to depth can be measured. All default to
+// on; change them only between searches.
+typedef struct {
+    int pvs;             // Principal variation search: null windows after the first move
+    int aspiration;      // Root window around the previous iteration's score
+    int nullMove;        // Null-move pruning, with zugzwang guards
+    int lmr;             // Late move reductions
+    int reverseFutility; // Cut when the static eval is far above beta
+    int futility;        // Skip quiet moves near the leaves that cannot reach alpha
+    int mateDistance;    // Cut lines that cannot beat a mate already found
+} SearchOptions;
+
+extern SearchOptions searchOptions;
+
+typedef struct SearchPool SearchPool;
+
+// Everything one search thread touches apart from the shared transposition
+// table, so any number can run at once
+typedef struct {
+    Position pos;
+    StateInfo states[MAX_PLY];
+    uint64_t keys[MAX_REPETITION_KEYS + MAX_PLY]; // Keys of the line so far, current last
+    int keyCount;
+    Move pv[MAX_PLY][MAX_PLY];  // Triangular PV table: pv[ply] holds the line from ply
+    int pvLength[MAX_PLY];
+    Move prevPv[MAX_PLY];       // Previous iteration's line, tried first at each ply
+    Move played[MAX_PLY];       // Move made at each ply of the line, MOVE_NONE for a null move
+    int nullMinPly;             // No null moves before this ply while verifying one
+    Move killers[MAX_PLY][2];   // Last two quiet moves that cut off at each ply
+    HistoryTable history;       // Quiet move success, for ordering
+    NnueAccumulator acc[MAX_PLY + 1]; // Network accumulators by ply, when a network is loaded
+    PawnTable pawns;            // Pawn structure cache, used without a network
+    MaterialTable material;     // Material terms and endgame recognition, likewise
+    uint64_t tbHits;            // Tablebase probes that answered
+    SearchLimits limits;
+    double startMs;
+    _Atomic uint64_t nodes; // Only its own thread writes, the main thread sums
+    SearchPool *pool;
+    int id;                 // 0 is the main thread, which owns limits and result
+} SearchThread;
+
+// Lazy SMP: every thread runs the same iterative deepening on its own copy
+// of the position, helpers at staggered depths, and they cooperate only
+// through the transposition table
+struct SearchPool {
+    SearchThread *threads;
+    int count;
+    atomic_int stop;
+};
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+int initSearchPool(SearchPool *pool, int threads);
+void freeSearchPool(SearchPool *pool);
+void searchPosition(SearchPool *pool, const Position *pos, const uint64_t *history, int historyCount,
+                    const SearchLimits *limits, SearchResult *result);
+void stopSearch(SearchPool *pool);
+int setSearchOption(const char *name, int enabled);
+
+#endif
@@ -0,0 +1,885 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "syzygy.h"
+#include "mapfile.h"
+#include "movegen.h"
+
+// Table layout and indexing follow the Syzygy format as its generator
+// writes it; the comments name each part but the format itself is fixed.
+
+#ifdef _WIN32
+#define PATH_SEPARATOR ';'
+#else
+#define PATH_SEPARATOR ':'
+#endif
+
+#define MAX_TB_DIRS 16
+#define TB_SLOTS 8192 // Hash slots for material keys, two per table
+
+// Flags of each table part
+enum { TB_STM = 1, TB_MAPPED = 2, TB_WIN_PLIES = 4, TB_LOSS_PLIES = 8, TB_WIDE = 16, TB_SINGLE_VALUE = 128 };
+
+// How a probe went: DTZ files hold one side to move only, and some results
+// are settled by a capture or pawn move before the table is consulted
+enum { PROBE_FAIL, PROBE_OK, PROBE_CHANGE_STM, PROBE_ZEROING_BEST_MOVE };
+
+// ------------------ STRUCT DEFINITIONS ------------------
+// One compressed part of a table: positions are indexed, the index picks a
+// block, and the block holds Huffman-coded symbols that each expand, by
+// recursive pairing, into a run of values
+typedef struct {
+    uint8_t flags;
+    uint8_t maxSymLen, minSymLen;  // Code lengths; minSymLen is the value itself with TB_SINGLE_VALUE
+    uint64_t *base64;              // Smallest left-aligned code of each length, longest last
+    uint8_t *symlen;               // Values each symbol expands to, less one
+    int symCount;
+    const uint8_t *lowestSym;      // Little-endian uint16 per code length
+    const uint8_t *btree;          // 3 bytes per symbol: its left and right halves, 12 bits each
+    uint64_t sizeofBlock, span;    // Block size; positions between sparse index entries
+    size_t sparseIndexSize, blockLengthSize;
+    uint32_t blocksNum;
+    const uint8_t *sparseIndex;    // 6 bytes per entry: block (uint32) and offset in it (uint16)
+    const uint8_t *blockLength;    // Values in each block less one, uint16
+    const uint8_t *data;           // First block
+    uint16_t mapIdx[4];            // DTZ only: where the value map of each outcome starts
+    Piece pieces[TB_PIECES];       // Order in which the pieces are indexed
+    uint64_t groupIdx[TB_PIECES + 1];
+    int groupLen[TB_PIECES + 1];   // Pieces indexed together, zero-terminated
+} PairsData;
+
+typedef struct {
+    _Atomic int ready;         // Set once mapping was attempted
+    int failed;
+    MappedFile file;
+    PairsData pairs[2][4];     // [side to move][leading pawn file], [0][0] alone without pawns
+    const uint8_t *map;        // DTZ only: value maps
+} TableFile;
+
+typedef struct {
+    uint64_t key, key2;        // Material keys with the first-named side as White, and as Black
+    char name[TB_PIECES + 2];  // For instance "KRvK"
+    int dir, dtzDir;           // Directory holding each file, -1 if missing
+    int pieceCount, hasPawns, hasUniquePieces;
+    int pawnCount[2];          // Pawns of the leading color, then of the other
+    TableFile wdl, dtz;
+} SyzygyTable;
+
+// ------------------ GLOBALS ------------------
+int syzygyMaxPieces = 0;
+
+static char tbPath[4096];
+static const char *tbDirs[MAX_TB_DIRS];
+static int tbDirCount;
+
+static SyzygyTable *tables;
+static int tableCount, tableCapacity;
+static struct {
+    uint64_t key;
+    int index; // Into tables, plus one; 0 for an empty slot
+} tbSlots[TB_SLOTS];
+
+static pthread_mutex_t mapLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Index tables shared by every file
+static int mapB1H1H7[64];          // Squares below the a1-h8 diagonal to 0..27
+static int mapA1D1D4[64];          // Squares of the a1-d1-d4 triangle to 0..9
+static int mapKK[10][64];          // The 462 placements of two kings, the first in the triangle
+static int mapPawns[64];           // Squares a2-h7 to 47..0, edge files and low ranks first
+static uint64_t binomial[TB_PIECES - 1][64];
+static int leadPawnIdx[TB_PIECES - 1][64];
+static int leadPawnsSize[TB_PIECES - 1][4];
+
+// ------------------ BYTE ACCESS ------------------
+static uint16_t readLe16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t readLe32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t readBe32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static uint64_t readBe64(const uint8_t *p) {
+    return (uint64_t)readBe32(p) << 32 | readBe32(p + 4);
+}
+
+static int btreeLeft(const PairsData *d, int sym) {
+    const uint8_t *lr = d->btree + 3 * sym;
+    return (lr[1] & 0xF) << 8 | lr[0];
+}
+
+static int btreeRight(const PairsData *d, int sym) {
+    const uint8_t *lr = d->btree + 3 * sym;
+    return lr[2] << 4 | lr[1] >> 4;
+}
+
+// ------------------ INDEXING ------------------
+// Ranks minus files: negative below the a1-h8 diagonal, 0 on it
+static int offDiagonal(int sq) {
+    return squareRank(sq) - squareCol(sq);
+}
+
+static void initIndexing(void) {
+    int code = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        if (offDiagonal(sq) < 0) mapB1H1H7[sq] = code++;
+    }
+
+    // The triangle's diagonal squares come last
+    code = 0;
+    for (int sq = 0; sq <= 27; sq++) {
+        if (offDiagonal(sq) < 0 && squareCol(sq) <= 3) mapA1D1D4[sq] = code++;
+    }
+    for (int sq = 0; sq <= 27; sq++) {
+        if (!offDiagonal(sq) && squareCol(sq) <= 3) mapA1D1D4[sq] = code++;
+    }
+
+    // With the first king on the diagonal the second stays on or below it;
+    // placements with both on the diagonal come last
+    int diagonalIdx[64], diagonalSq[64], diagonalCount = 0;
+    code = 0;
+    for (int idx = 0; idx < 10; idx++) {
+        for (int s1 = 0; s1 <= 27; s1++) {
+            if (mapA1D1D4[s1] != idx || (!idx && s1 != 1)) continue; // b1 is the one mapped to 0
+            for (int s2 = 0; s2 < 64; s2++) {
+                if ((kingAttacks[s1] | SQUARE_BB(s1)) & SQUARE_BB(s2)) continue;
+                if (!offDiagonal(s1) && offDiagonal(s2) > 0) continue;
+                if (!offDiagonal(s1) && !offDiagonal(s2)) {
+                    diagonalIdx[diagonalCount] = idx;
+                    diagonalSq[diagonalCount++] = s2;
+                } else {
+                    mapKK[idx][s2] = code++;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < diagonalCount; i++) mapKK[diagonalIdx[i]][diagonalSq[i]] = code++;
+
+    binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++) {
+        for (int k = 0; k < TB_PIECES - 1 && k <= n; k++) {
+            binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+        }
+    }
+
+    // A table with pawns is split by the file of its leading pawn, a-d
+    int available = 47;
+    for (int leadPawns = 1; leadPawns < TB_PIECES - 1; leadPawns++) {
+        for (int file = 0; file <= 3; file++) {
+            int idx = 0;
+            for (int rank = 1; rank <= 6; rank++) {
+                int sq = rank * 8 + file;
+                if (leadPawns == 1) {
+                    mapPawns[sq] = available--;
+                    mapPawns[sq ^ 7] = available--;
+                }
+                leadPawnIdx[leadPawns][sq] = idx;
+                idx += (int)binomial[leadPawns - 1][mapPawns[sq]];
+            }
+            leadPawnsSize[leadPawns][file] = idx;
+        }
+    }
+}
+
+// ------------------ FILE PARSING ------------------
+// Pieces are indexed in groups: the leading group (kings and a unique
+// piece, or the leading pawns), the other side's pawns, then each run of
+// like pieces. 'order' tells where the first two groups fall in the index.
+static void setGroups(const SyzygyTable *e, PairsData *d, const int order[2], int file) {
+    int n = 0, firstLen = e->hasPawns ? 0 : e->hasUniquePieces ? 3 : 2;
+    d->groupLen[n] = 1;
+    for (int i = 1; i < e->pieceCount; i++) {
+        if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1]) d->groupLen[n]++;
+        else d->groupLen[++n] = 1;
+    }
+    d->groupLen[++n] = 0;
+
+    int pp = e->hasPawns && e->pawnCount[1];
+    int next = pp ? 2 : 1;
+    int freeSquares = 64 - d->groupLen[0] - (pp ? d->groupLen[1] : 0);
+    uint64_t idx = 1;
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+        if (k == order[0]) {
+            d->groupIdx[0] = idx;
+            idx *= e->hasPawns ? (uint64_t)leadPawnsSize[d->groupLen[0]][file] : e->hasUniquePieces ? 31332 : 462;
+        } else if (k == order[1]) {
+            d->groupIdx[1] = idx;
+            idx *= binomial[d->groupLen[1]][48 - d->groupLen[0]];
+        } else {
+            d->groupIdx[next] = idx;
+            idx *= binomial[d->groupLen[next]][freeSquares];
+            freeSquares -= d->groupLen[next++];
+        }
+    }
+    d->groupIdx[n] = idx;
+}
+
+static int setSymlen(PairsData *d, int sym, uint8_t *visited) {
+    visited[sym] = 1;
+    int right = btreeRight(d, sym);
+    if (right == 0xFFF) return 0;
+    int left = btreeLeft(d, sym);
+    if (!visited[left]) d->symlen[left] = (uint8_t)setSymlen(d, left, visited);
+    if (!visited[right]) d->symlen[right] = (uint8_t)setSymlen(d, right, visited);
+    return d->symlen[left] + d->symlen[right] + 1;
+}
+
+// Reads the block sizes and the Huffman code of one part; NULL if the
+// data is unusable
+static const uint8_t *setSizes(PairsData *d, const uint8_t *data) {
+    d->flags = *data++;
+    if (d->flags & TB_SINGLE_VALUE) {
+        d->minSymLen = *data++;
+        return data;
+    }
+
+    int n = 0;
+    while (d->groupLen[n]) n++;
+    uint64_t tbSize = d->groupIdx[n];
+    d->sizeofBlock = 1ULL << data[0];
+    d->span = 1ULL << data[1];
+    d->sparseIndexSize = (size_t)((tbSize + d->span - 1) / d->span);
+    int padding = data[2];
+    d->blocksNum = readLe32(data + 3);
+    d->blockLengthSize = d->blocksNum + (size_t)padding;
+    d->maxSymLen = data[7];
+    d->minSymLen = data[8];
+    d->lowestSym = data + 9;
+    data += 9;
+    if (d->maxSymLen < d->minSymLen || !d->minSymLen || d->maxSymLen > 32) return NULL;
+
+    // Canonical code: longer codes have lower values, so the smallest code of
+    // each length, left-aligned in 64 bits, decreases with length
+    int lengths = d->maxSymLen - d->minSymLen + 1;
+    d->base64 = calloc((size_t)lengths, sizeof(uint64_t));
+    if (!d->base64) return NULL;
+    for (int i = lengths - 2; i >= 0; i--) {
+        d->base64[i] = (d->base64[i + 1] + readLe16(d->lowestSym + 2 * i) - readLe16(d->lowestSym + 2 * (i + 1))) / 2;
+    }
+    for (int i = 0; i < lengths; i++) d->base64[i] <<= 64 - i - d->minSymLen;
+    data += 2 * lengths;
+
+    d->symCount = readLe16(data);
+    data += 2;
+    d->btree = data;
+    d->symlen = calloc((size_t)d->symCount + 1, 1);
+    uint8_t *visited = calloc((size_t)d->symCount + 1, 1);
+    if (!d->symlen || !visited) {
+        free(visited);
+        return NULL;
+    }
+    for (int sym = 0; sym < d->symCount; sym++) {
+        if (!visited[sym]) d->symlen[sym] = (uint8_t)setSymlen(d, sym, visited);
+    }
+    free(visited);
+    return data + 3 * d->symCount + (d->symCount & 1);
+}
+
+// DTZ values are stored through a small map per outcome
+static const uint8_t *setDtzMap(TableFile *tf, const uint8_t *data, int maxFile) {
+    tf->map = data;
+    for (int f = 0; f <= maxFile; f++) {
+        PairsData *d = &tf->pairs[0][f];
+        if (!(d->flags & TB_MAPPED)) continue;
+        if (d->flags & TB_WIDE) {
+            data += (uintptr_t)data & 1;
+            for (int i = 0; i < 4; i++) {
+                d->mapIdx[i] = (uint16_t)((data - tf->map) / 2 + 1);
+                data += 2 * readLe16(data) + 2;
+            }
+        } else {
+            for (int i = 0; i < 4; i++) {
+                d->mapIdx[i] = (uint16_t)(data - tf->map + 1);
+                data += *data + 1;
+            }
+        }
+    }
+    return data + ((uintptr_t)data & 1);
+}
+
+static int parseTable(const SyzygyTable *e, TableFile *tf, int dtz) {
+    static const uint8_t magics[2][4] = {{0x71, 0xE8, 0x23, 0x5D}, {0xD7, 0x66, 0x0C, 0xA5}};
+    const uint8_t *start = tf->file.data, *end = start + tf->file.size, *data = start + 4;
+    if (tf->file.size < 8 || memcmp(start, magics[dtz], 4)) return 0;
+    if (!(*data & 2) != !e->hasPawns || !(*data & 1) != (e->key == e->key2)) return 0;
+    data++;
+
+    int sides = !dtz && e->key != e->key2 ? 2 : 1;
+    int maxFile = e->hasPawns ? 3 : 0;
+    int pp = e->hasPawns && e->pawnCount[1]; // Pawns on both sides
+    for (int f = 0; f <= maxFile; f++) {
+        int order[2][2] = {{data[0] & 0xF, pp ? data[1] & 0xF : 0xF}, {data[0] >> 4, pp ? data[1] >> 4 : 0xF}};
+        data += 1 + pp;
+        for (int k = 0; k < e->pieceCount; k++, data++) {
+            for (int i = 0; i < sides; i++) tf->pairs[i][f].pieces[k] = (Piece)(i ? *data >> 4 : *data & 0xF);
+        }
+        for (int i = 0; i < sides; i++) setGroups(e, &tf->pairs[i][f], order[i], f);
+    }
+    data += (uintptr_t)data & 1;
+
+    for (int f = 0; f <= maxFile; f++) {
+        for (int i = 0; i < sides; i++) {
+            if (data >= end || !(data = setSizes(&tf->pairs[i][f], data))) return 0;
+        }
+    }
+    if (dtz) data = setDtzMap(tf, data, maxFile);
+    for (int f = 0; f <= maxFile; f++) {
+        for (int i = 0; i < sides; i++) {
+            tf->pairs[i][f].sparseIndex = data;
+            data += tf->pairs[i][f].sparseIndexSize * 6;
+        }
+    }
+    for (int f = 0; f <= maxFile; f++) {
+        for (int i = 0; i < sides; i++) {
+            tf->pairs[i][f].blockLength = data;
+            data += tf->pairs[i][f].blockLengthSize * 2;
+        }
+    }
+    for (int f = 0; f <= maxFile; f++) {
+        for (int i = 0; i < sides; i++) {
+            data = start + ((size_t)(data - start + 63) & ~(size_t)63); // Blocks are 64-byte aligned
+            tf->pairs[i][f].data = data;
+            data += tf->pairs[i][f].blocksNum * tf->pairs[i][f].sizeofBlock;
+        }
+    }
+    return data <= end;
+}
+
+static void freeTableFile(TableFile *tf) {
+    for (int i = 0; i < 2; i++) {
+        for (int f = 0; f < 4; f++) {
+            free(tf->pairs[i][f].base64);
+            free(tf->pairs[i][f].symlen);
+        }
+    }
+    unmapFile(&tf->file);
+    memset(tf, 0, sizeof(*tf));
+}
+
+// Maps and parses a file on its first probe; later probes, from any thread,
+// only read the flag
+static int ensureMapped(SyzygyTable *e, TableFile *tf, int dtz) {
+    if (atomic_load_explicit(&tf->ready, memory_order_acquire)) return !tf->failed;
+    pthread_mutex_lock(&mapLock);
+    if (!atomic_load_explicit(&tf->ready, memory_order_relaxed)) {
+        int dir = dtz ? e->dtzDir : e->dir;
+        char path[sizeof(tbPath) + 32];
+        snprintf(path, sizeof(path), "%s/%s%s", dir >= 0 ? tbDirs[dir] : ".", e->name, dtz ? ".rtbz" : ".rtbw");
+        tf->failed = dir < 0 || !mapFile(&tf->file, path) || !parseTable(e, tf, dtz);
+        if (tf->failed) {
+            freeTableFile(tf);
+            tf->failed = 1;
+        }
+        atomic_store_explicit(&tf->ready, 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&mapLock);
+    return !tf->failed;
+}
+
+// ------------------ DECOMPRESSION ------------------
+// Value number 'idx' of a part. The sparse index gives a block near it,
+// the block lengths the exact one, and the block is decoded in place from
+// the mapping up to the symbol that covers it.
+static int decompressPairs(const PairsData *d, uint64_t idx) {
+    if (d->flags & TB_SINGLE_VALUE) return d->minSymLen;
+
+    uint32_t k = (uint32_t)(idx / d->span);
+    uint32_t block = readLe32(d->sparseIndex + 6 * (size_t)k);
+    int offset = readLe16(d->sparseIndex + 6 * (size_t)k + 4);
+    offset += (int)(idx % d->span) - (int)(d->span / 2);
+    while (offset < 0) offset += readLe16(d->blockLength + 2 * (size_t)--block) + 1;
+    while (offset > readLe16(d->blockLength + 2 * (size_t)block)) {
+        offset -= readLe16(d->blockLength + 2 * (size_t)block++) + 1;
+    }
+
+    const uint8_t *ptr = d->data + (uint64_t)block * d->sizeofBlock;
+    uint64_t buf64 = readBe64(ptr);
+    int buf64Size = 64;
+    ptr += 8;
+    int sym;
+    for (;;) {
+        // The code length is the first whose smallest code is not above
+        // the buffer; codes of one length are consecutive numbers
+        int len = 0;
+        while (buf64 < d->base64[len]) len++;
+        sym = (int)((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+        sym += readLe16(d->lowestSym + 2 * len);
+        if (offset < d->symlen[sym] + 1) break;
+
+        offset -= d->symlen[sym] + 1;
+        len += d->minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+        if (buf64Size <= 32) {
+            buf64Size += 32;
+            buf64 |= (uint64_t)readBe32(ptr) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // Expand the symbol's pairs down to the single value at 'offset'
+    while (d->symlen[sym]) {
+        int left = btreeLeft(d, sym);
+        if (offset < d->symlen[left] + 1) {
+            sym = left;
+        } else {
+            offset -= d->symlen[left] + 1;
+            sym = btreeRight(d, sym);
+        }
+    }
+    return btreeLeft(d, sym);
+}
+
+// ------------------ TABLE PROBING ------------------
+static SyzygyTable *findTable(uint64_t key) {
+    for (int i = (int)(key & (TB_SLOTS - 1)); tbSlots[i].index; i = (i + 1) & (TB_SLOTS - 1)) {
+        if (tbSlots[i].key == key) return &tables[tbSlots[i].index - 1];
+    }
+    return NULL;
+}
+
+// DTZ tables store moves or plies per outcome; plies are returned
+static int mapDtz(const TableFile *tf, const PairsData *d, int value, int wdl) {
+    static const int wdlMap[5] = {1, 3, 0, 2, 0};
+    if (d->flags & TB_MAPPED) {
+        int i = d->mapIdx[wdlMap[wdl + 2]] + value;
+        value = (d->flags & TB_WIDE) ? readLe16(tf->map + 2 * i) : tf->map[i];
+    }
+    if ((wdl == TB_WIN && !(d->flags & TB_WIN_PLIES)) || (wdl == TB_LOSS && !(d->flags & TB_LOSS_PLIES)) ||
+        wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS) value *= 2;
+    return value + 1;
+}
+
+// Looks the position up in its table, which is stored with the stronger
+// side as White: colors and squares are flipped as needed, then mirrored so
+// the leading piece lands in the indexed part of the board
+static int probeTable(const Position *pos, SyzygyTable *e, TableFile *tf, int dtz, int wdl, int *state) {
+    int squares[TB_PIECES] = {0};
+    Piece pieces[TB_PIECES];
+    int size = 0, leadPawnsCnt = 0, tbFile = 0;
+    Bitboard b, leadPawns = 0;
+    uint64_t idx;
+
+    int flip = (e->key == e->key2 && pos->sideToMove == BLACK) || pos->materialKey != e->key;
+    int flipColor = flip * 8, flipSquares = flip * 56;
+    int stm = flip ^ pos->sideToMove;
+
+    if (e->hasPawns) {
+        Piece pc = tf->pairs[0][0].pieces[0] ^ flipColor;
+        leadPawns = b = pos->pieces[pieceColor(pc)][PAWN];
+        while (b) squares[size++] = popLsb(&b) ^ flipSquares;
+        leadPawnsCnt = size;
+        int lead = 0;
+        for (int i = 1; i < size; i++) {
+            if (mapPawns[squares[i]] > mapPawns[squares[lead]]) lead = i;
+        }
+        int tmp = squares[0];
+        squares[0] = squares[lead];
+        squares[lead] = tmp;
+        tbFile = squareCol(squares[0]) > 3 ? 7 - squareCol(squares[0]) : squareCol(squares[0]);
+    }
+
+    if (dtz && (tf->pairs[0][tbFile].flags & TB_STM) != stm && !(e->key == e->key2 && !e->hasPawns)) {
+        *state = PROBE_CHANGE_STM;
+        return 0;
+    }
+
+    b = pos->occupied ^ leadPawns;
+    while (b) {
+        int sq = popLsb(&b);
+        squares[size] = sq ^ flipSquares;
+        pieces[size++] = pos->board[sq] ^ flipColor;
+    }
+
+    const PairsData *d = &tf->pairs[dtz ? 0 : stm][tbFile];
+
+    // Same piece sequence as the table's
+    for (int i = leadPawnsCnt; i < size - 1; i++) {
+        for (int j = i + 1; j < size; j++) {
+            if (d->pieces[i] != pieces[j]) continue;
+            Piece p = pieces[i];
+            int sq = squares[i];
+            pieces[i] = pieces[j];
+            squares[i] = squares[j];
+            pieces[j] = p;
+            squares[j] = sq;
+            break;
+        }
+    }
+
+    if (squareCol(squares[0]) > 3) {
+        for (int i = 0; i < size; i++) squares[i] ^= 7;
+    }
+
+    if (e->hasPawns) {
+        idx = (uint64_t)leadPawnIdx[leadPawnsCnt][squares[0]];
+        for (int i = 2; i < leadPawnsCnt; i++) {
+            for (int j = i; j > 1 && mapPawns[squares[j - 1]] > mapPawns[squares[j]]; j--) {
+                int tmp = squares[j];
+                squares[j] = squares[j - 1];
+                squares[j - 1] = tmp;
+            }
+        }
+        for (int i = 1; i < leadPawnsCnt; i++) idx += binomial[i][mapPawns[squares[i]]];
+    } else {
+        if (squareRank(squares[0]) > 3) {
+            for (int i = 0; i < size; i++) squares[i] ^= 56;
+        }
+        // The first leading piece off the a1-h8 diagonal goes below it
+        for (int i = 0; i < d->groupLen[0]; i++) {
+            int off = offDiagonal(squares[i]);
+            if (!off) continue;
+            if (off > 0) {
+                for (int j = i; j < size; j++) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            }
+            break;
+        }
+
+        if (e->hasUniquePieces) {
+            // Kings and a unique piece together
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (offDiagonal(squares[0])) {
+                idx = ((uint64_t)mapA1D1D4[squares[0]] * 63 + (uint64_t)(squares[1] - adjust1)) * 62 +
+                      (uint64_t)(squares[2] - adjust2);
+            } else if (offDiagonal(squares[1])) {
+                idx = (uint64_t)(6 * 63 + squareRank(squares[0]) * 28 + mapB1H1H7[squares[1]]) * 62 +
+                      (uint64_t)(squares[2] - adjust2);
+            } else if (offDiagonal(squares[2])) {
+                idx = (uint64_t)(6 * 63 * 62 + 4 * 28 * 62 + squareRank(squares[0]) * 7 * 28 +
+                                 (squareRank(squares[1]) - adjust1) * 28 + mapB1H1H7[squares[2]]);
+            } else {
+                idx = (uint64_t)(6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + squareRank(squares[0]) * 7 * 6 +
+                                 (squareRank(squares[1]) - adjust1) * 6 + (squareRank(squares[2]) - adjust2));
+            }
+        } else {
+            idx = (uint64_t)mapKK[mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // The remaining groups, each as a combination of the squares left over
+    idx *= d->groupIdx[0];
+    int *groupSq = squares + d->groupLen[0];
+    int remainingPawns = e->hasPawns && e->pawnCount[1];
+    for (int next = 1; d->groupLen[next]; next++) {
+        int len = d->groupLen[next];
+        for (int i = 1; i < len; i++) {
+            for (int j = i; j > 0 && groupSq[j - 1] > groupSq[j]; j--) {
+                int tmp = groupSq[j];
+                groupSq[j] = groupSq[j - 1];
+                groupSq[j - 1] = tmp;
+            }
+        }
+        uint64_t n = 0;
+        for (int i = 0; i < len; i++) {
+            int adjust = 0;
+            for (const int *s = squares; s < groupSq; s++) adjust += groupSq[i] > *s;
+            n += binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = 0;
+        idx += n * d->groupIdx[next];
+        groupSq += len;
+    }
+
+    int value = decompressPairs(d, idx);
+    return dtz ? mapDtz(tf, d, value, wdl) : value - 2;
+}
+
+static int probe(const Position *pos, int dtz, int wdl, int *state) {
+    if (popCount(pos->occupied) == 2) return 0; // Bare kings
+    SyzygyTable *e = findTable(pos->materialKey);
+    TableFile *tf = e ? (dtz ? &e->dtz : &e->wdl) : NULL;
+    if (!tf || !ensureMapped(e, tf, dtz)) {
+        *state = PROBE_FAIL;
+        return 0;
+    }
+    return probeTable(pos, e, tf, dtz, wdl, state);
+}
+
+// ------------------ PROBING ------------------
+static int isCapture(const Position *pos, Move move) {
+    return moveFlag(move) == MOVE_EN_PASSANT || (moveFlag(move) != MOVE_CASTLING && pos->board[moveTo(move)]);
+}
+
+static int isMate(Position *pos) {
+    Move moves[MAX_MOVES];
+    return isInCheck(pos, pos->sideToMove) && generateLegalMoves(pos, moves) == 0;
+}
+
+// Tables leave out positions with an en passant capture and store a
+// "don't care" wherever a capture (or, for DTZ, a pawn move) is best, so
+// those moves are searched first and the table is consulted only when
+// they do not settle the outcome
+static int searchWdl(Position *pos, int zeroingPawnMoves, int *state) {
+    Move moves[MAX_MOVES];
+    int total = generateLegalMoves(pos, moves), count = 0, best = TB_LOSS, value;
+    for (int i = 0; i < total; i++) {
+        Move move = moves[i];
+        if (!isCapture(pos, move) && (!zeroingPawnMoves || pieceTypeOn(pos, moveFrom(move)) != PAWN)) continue;
+        count++;
+        StateInfo st;
+        makeMove(pos, move, &st);
+        value = -searchWdl(pos, 0, state);
+        unmakeMove(pos, move, &st);
+        if (*state == PROBE_FAIL) return TB_DRAW;
+        if (value > best) {
+            best = value;
+            if (value >= TB_WIN) {
+                *state = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    int noMoreMoves = count && count == total;
+    if (noMoreMoves) {
+        value = best;
+    } else {
+        value = probe(pos, 0, TB_DRAW, state);
+        if (*state == PROBE_FAIL) return TB_DRAW;
+    }
+    if (best >= value) {
+        *state = best > TB_DRAW || noMoreMoves ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+        return best;
+    }
+    *state = PROBE_OK;
+    return value;
+}
+
+// DTZ of a position whose best move zeroes the fifty-move counter
+static int dtzBeforeZeroing(int wdl) {
+    return wdl == TB_WIN ? 1 : wdl == TB_CURSED_WIN ? 101 : wdl == TB_BLESSED_LOSS ? -101 : wdl == TB_LOSS ? -1 : 0;
+}
+
+static int probeDtz(Position *pos, int *state) {
+    *state = PROBE_OK;
+    int wdl = searchWdl(pos, 1, state);
+    if (*state == PROBE_FAIL || wdl == TB_DRAW) return 0;
+    if (*state == PROBE_ZEROING_BEST_MOVE) return dtzBeforeZeroing(wdl);
+
+    int dtz = probe(pos, 1, wdl, state);
+    if (*state == PROBE_FAIL) return 0;
+    if (*state != PROBE_CHANGE_STM) {
+        return (dtz + 100 * (wdl == TB_BLESSED_LOSS || wdl == TB_CURSED_WIN)) * (wdl > 0 ? 1 : -1);
+    }
+
+    // The file holds the other side to move: take the best reply's DTZ
+    Move moves[MAX_MOVES];
+    int count = generateLegalMoves(pos, moves), minDtz = 0xFFFF;
+    for (int i = 0; i < count; i++) {
+        Move move = moves[i];
+        int zeroing = isCapture(pos, move) || pieceTypeOn(pos, moveFrom(move)) == PAWN;
+        StateInfo st;
+        makeMove(pos, move, &st);
+        if (zeroing) {
+            dtz = -dtzBeforeZeroing(searchWdl(pos, 0, state));
+        } else {
+            dtz = -probeDtz(pos, state);
+        }
+        if (dtz == 1 && isMate(pos)) minDtz = 1;
+        if (!zeroing) dtz += dtz > 0 ? 1 : dtz < 0 ? -1 : 0;
+        if (dtz < minDtz && (dtz > 0) - (dtz < 0) == (wdl > 0) - (wdl < 0)) minDtz = dtz;
+        unmakeMove(pos, move, &st);
+        if (*state == PROBE_FAIL) return 0;
+    }
+    return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+static int inRange(const Position *pos) {
+    return !pos->castling && popCount(pos->occupied) <= syzygyMaxPieces;
+}
+
+// Win, draw or loss for the side to move; '*success' is 0 when the position
+// is not covered (castling rights, too many pieces, no file)
+int syzygyProbeWdl(Position *pos, int *success) {
+    int state = PROBE_OK;
+    int wdl = inRange(pos) ? searchWdl(pos, 0, &state) : (state = PROBE_FAIL, TB_DRAW);
+    *success = state != PROBE_FAIL;
+    return wdl;
+}
+
+// Plies to the next capture or pawn move with best play, positive when the
+// side to move wins, 0 for a draw, and beyond 100 in absolute value for a
+// result the fifty-move rule turns into a draw
+int syzygyProbeDtz(Position *pos, int *success) {
+    int state = PROBE_OK;
+    int dtz = inRange(pos) ? probeDtz(pos, &state) : (state = PROBE_FAIL, 0);
+    *success = state != PROBE_FAIL;
+    return dtz;
+}
+
+// The move that keeps the best outcome the fifty-move rule allows: the
+// fastest zeroing move of a win, a drawing move, or the longest resistance,
+// with '*wdl' and '*dtz' describing it. MOVE_NONE if the position is not
+// covered by the tables found.
+Move syzygyProbeRoot(Position *pos, int *wdl, int *dtz) {
+    Move moves[MAX_MOVES], best = MOVE_NONE;
+    int bestRank = INT_MIN, bestDtz = 0;
+    if (!inRange(pos)) return MOVE_NONE;
+    int count = generateLegalMoves(pos, moves);
+    int clock = pos->halfmoveClock;
+    for (int i = 0; i < count; i++) {
+        StateInfo st;
+        int state = PROBE_OK, d;
+        makeMove(pos, moves[i], &st);
+        if (pos->halfmoveClock == 0) {
+            d = dtzBeforeZeroing(-searchWdl(pos, 0, &state));
+        } else {
+            d = -probeDtz(pos, &state);
+            d = d > 0 ? d + 1 : d < 0 ? d - 1 : 0;
+        }
+        if (d == 2 && isMate(pos)) d = 1;
+        unmakeMove(pos, moves[i], &st);
+        if (state == PROBE_FAIL) return MOVE_NONE;
+
+        // Wins within the fifty moves rank equal; beyond them, and for
+        // losses that reach them, the count decides
+        int rank = 0;
+        if (d > 0) rank = d + clock <= 99 ? 1000 : 1000 - (d + clock);
+        else if (d < 0) rank = -d * 2 + clock < 100 ? -1000 : -1000 + (-d + clock);
+        if (rank > bestRank || (rank == bestRank && d < bestDtz)) {
+            best = moves[i];
+            bestRank = rank;
+            bestDtz = d;
+        }
+    }
+    if (best == MOVE_NONE) return MOVE_NONE;
+    *dtz = bestDtz;
+    *wdl = bestDtz > 0 ? (bestDtz + clock <= 100 ? TB_WIN : TB_CURSED_WIN)
+         : bestDtz < 0 ? (-bestDtz + clock <= 100 ? TB_LOSS : TB_BLESSED_LOSS) : TB_DRAW;
+    return best;
+}
+
+// ------------------ TABLE DISCOVERY ------------------
+static int findFile(const char *name, const char *ext) {
+    char path[sizeof(tbPath) + 32];
+    for (int i = 0; i < tbDirCount; i++) {
+        snprintf(path, sizeof(path), "%s/%s%s", tbDirs[i], name, ext);
+        FILE *f = fopen(path, "rb");
+        if (f) {
+            fclose(f);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void insertKey(uint64_t key, int index) {
+    int i = (int)(key & (TB_SLOTS - 1));
+    while (tbSlots[i].index && tbSlots[i].key != key) i = (i + 1) & (TB_SLOTS - 1);
+    tbSlots[i].key = key;
+    tbSlots[i].index = index + 1;
+}
+
+// Registers the table of these pieces, kings left out, strongest first,
+// if its file is present. Returns whether it was.
+static int addTable(const char *white, const char *black) {
+    char name[TB_PIECES + 2];
+    snprintf(name, sizeof(name), "K%svK%s", white, black);
+    int dir = findFile(name, ".rtbw");
+    if (dir < 0 || tableCount >= TB_SLOTS / 2) return 0;
+    if (tableCount == tableCapacity) {
+        int capacity = tableCapacity ? 2 * tableCapacity : 64;
+        SyzygyTable *grown = realloc(tables, (size_t)capacity * sizeof(SyzygyTable));
+        if (!grown) return 0;
+        tables = grown;
+        tableCapacity = capacity;
+    }
+
+    SyzygyTable *e = &tables[tableCount];
+    memset(e, 0, sizeof(*e));
+    strcpy(e->name, name);
+    e->dir = dir;
+    e->dtzDir = findFile(name, ".rtbz");
+
+    int counts[2][6] = {{0}}, swapped[2][6];
+    counts[WHITE][KING] = counts[BLACK][KING] = 1;
+    for (const char *p = white; *p; p++) counts[WHITE][typeIndex(*p)]++;
+    for (const char *p = black; *p; p++) counts[BLACK][typeIndex(*p)]++;
+    for (int t = PAWN; t <= KING; t++) {
+        swapped[WHITE][t] = counts[BLACK][t];
+        swapped[BLACK][t] = counts[WHITE][t];
+        for (int c = WHITE; c <= BLACK; c++) {
+            if (t != KING && counts[c][t] == 1) e->hasUniquePieces = 1;
+        }
+    }
+    e->key = materialKeyOf(counts);
+    e->key2 = materialKeyOf(swapped);
+    e->pieceCount = 2 + (int)strlen(white) + (int)strlen(black);
+    e->hasPawns = counts[WHITE][PAWN] + counts[BLACK][PAWN] > 0;
+
+    // Pawns lead from the side with fewer of them, which compresses better
+    int whiteLeads = !counts[BLACK][PAWN] || (counts[WHITE][PAWN] && counts[BLACK][PAWN] >= counts[WHITE][PAWN]);
+    e->pawnCount[0] = counts[whiteLeads ? WHITE : BLACK][PAWN];
+    e->pawnCount[1] = counts[whiteLeads ? BLACK : WHITE][PAWN];
+
+    insertKey(e->key, tableCount);
+    insertKey(e->key2, tableCount);
+    tableCount++;
+    if (e->pieceCount > syzygyMaxPieces) syzygyMaxPieces = e->pieceCount;
+    return 1;
+}
+
+// Every set of up to TB_PIECES - 2 pieces, written strongest first
+static int collectPieceSets(char sets[][TB_PIECES - 1], int count, char *current, int length, int maxType) {
+    memcpy(sets[count], current, (size_t)length);
+    sets[count++][length] = '\0';
+    if (length == TB_PIECES - 2) return count;
+    for (int t = maxType; t >= PAWN; t--) {
+        current[length] = typeChars[t];
+        count = collectPieceSets(sets, count, current, length + 1, t);
+    }
+    return count;
+}
+
+// Looks for tables in 'path', a list of directories separated by ':' (';'
+// on Windows), replacing any found before. Returns how many were found.
+// Not to be called while other threads probe.
+int syzygyInit(const char *path) {
+    static int indexingReady = 0;
+    if (!indexingReady) {
+        initIndexing();
+        indexingReady = 1;
+    }
+    syzygyFree();
+    if (!path || !*path) return 0;
+
+    snprintf(tbPath, sizeof(tbPath), "%s", path);
+    for (char *dir = tbPath; dir && tbDirCount < MAX_TB_DIRS;) {
+        char *next = strchr(dir, PATH_SEPARATOR);
+        if (next) *next++ = '\0';
+        if (*dir) tbDirs[tbDirCount++] = dir;
+        dir = next;
+    }
+
+    static char sets[256][TB_PIECES - 1];
+    char current[TB_PIECES];
+    int setCount = collectPieceSets(sets, 0, current, 0, QUEEN);
+    for (int i = 0; i < setCount; i++) {
+        for (int j = i; j < setCount; j++) {
+            if (strlen(sets[i]) + strlen(sets[j]) + 2 > TB_PIECES) continue;
+            if (!addTable(sets[i], sets[j]) && i != j) addTable(sets[j], sets[i]);
+        }
+    }
+    return tableCount;
+}
+
+void syzygyFree(void) {
+    for (int i = 0; i < tableCount; i++) {
+        freeTableFile(&tables[i].wdl);
+        freeTableFile(&tables[i].dtz);
+    }
+    free(tables);
+    tables = NULL;
+    tableCount = tableCapacity = 0;
+    memset(tbSlots, 0, sizeof(tbSlots));
+    tbDirCount = 0;
+    syzygyMaxPieces = 0;
+}
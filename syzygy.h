@@ -0,0 +1,27 @@
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+#include "position.h"
+
+// ------------------ SYZYGY TABLEBASES ------------------
+// Perfect endgame information from Syzygy tables on local disk: .rtbw files
+// give win/draw/loss, .rtbz files the distance to the next capture or pawn
+// move (DTZ) on the way there. Files are found at startup but mapped only
+// when first probed, and the OS pages in just the blocks that are read.
+// Every probe function may be called from any thread.
+#define TB_PIECES 7 // Most pieces, kings included, a table can hold
+
+// Outcome for the side to move. A cursed win or blessed loss is decided only
+// if the fifty-move rule is ignored, and is a draw under it.
+enum { TB_LOSS = -2, TB_BLESSED_LOSS = -1, TB_DRAW = 0, TB_CURSED_WIN = 1, TB_WIN = 2 };
+
+extern int syzygyMaxPieces; // Pieces in the largest table found, 0 without any
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+int syzygyInit(const char *path);
+void syzygyFree(void);
+int syzygyProbeWdl(Position *pos, int *success);
+int syzygyProbeDtz(Position *pos, int *success);
+Move syzygyProbeRoot(Position *pos, int *wdl, int *dtz);
+
+#endif
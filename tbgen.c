@@ -0,0 +1,561 @@
+// Endgame table generator: solves every position of an ending by retrograde
+// analysis and writes its distance-to-mate table (format in egtb.h).
+// gcc -O2 -pthread tbgen.c egtb.c mapfile.c bitboard.c position.c movegen.c evaluate.c pawns.c material.c
+//     endgame.c -o tbgen
+//   ./tbgen [options] KRvK KQvKR ...   solve these endings, after any they can turn into
+//   ./tbgen [options] --all N          solve every ending of 3 to N pieces (N at most 5)
+// Options: --dir D        read and write tables in D (the current directory by default)
+//          --threads N    split every pass over the table between N threads
+// Tables already in the directory are kept. Solving takes five bytes of
+// memory per entry: 26 MB for a four-piece ending without pawns, 1.7 GB for
+// five, and up to 4 GB for five with a pawn.
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "egtb.h"
+#include "movegen.h"
+#include "timer.h"
+
+#define UNKNOWN 0xFFFF // Value of an entry not decided yet
+#define NO_DUE 0xFFFF  // Due ply of an entry with no known result yet
+#define CHUNK 4096     // Entries a thread takes at a time
+
+// Entry flags: look at the moves again, the moves include a double pawn step
+// that allows an en passant capture, decided in the current pass, and no
+// position has this entry
+enum { RECHECK = 1, EP_SENSITIVE = 2, DECIDED = 4, UNUSED = 8 };
+
+// ------------------ STRUCT DEFINITIONS ------------------
+typedef struct {
+    uint64_t decided, pending;
+    int longest;
+} PassStats;
+
+typedef void (*PassFn)(int stm, uint64_t index, PassStats *stats);
+
+// The table being solved. An entry is decided at the pass whose number is
+// its distance to mate, so every entry decided earlier is at least as near.
+static EgtbMaterial mat;
+static uint16_t *values[2]; // Stored value (see egtb.h) by side to move, UNKNOWN until decided
+static uint16_t *dues[2];   // Plies to the mate a known move leads to, NO_DUE if none
+static uint8_t *flags[2];
+static int iteration;
+static Position emptyPosition;
+
+static const char *tableDir = ".";
+static int threadCount = 1;
+
+// ------------------ PARALLEL PASSES ------------------
+static PassFn passFn;
+static atomic_uint_fast64_t nextChunk;
+
+static void *passWorker(void *arg) {
+    PassStats *stats = arg;
+    uint64_t total = 2 * mat.entries;
+    for (;;) {
+        uint64_t begin = atomic_fetch_add(&nextChunk, 1) * CHUNK;
+        if (begin >= total) break;
+        uint64_t end = begin + CHUNK < total ? begin + CHUNK : total;
+        for (uint64_t n = begin; n < end; n++) passFn(n >= mat.entries, n % mat.entries, stats);
+    }
+    return NULL;
+}
+
+// Calls 'fn' once for every entry, spread over the threads
+static PassStats runPass(PassFn fn) {
+    PassStats stats[64];
+    pthread_t threads[64];
+    memset(stats, 0, sizeof(stats));
+    passFn = fn;
+    atomic_store(&nextChunk, 0);
+    for (int i = 1; i < threadCount; i++) pthread_create(&threads[i], NULL, passWorker, &stats[i]);
+    passWorker(&stats[0]);
+    for (int i = 1; i < threadCount; i++) pthread_join(threads[i], NULL);
+
+    for (int i = 1; i < threadCount; i++) {
+        stats[0].decided += stats[i].decided;
+        stats[0].pending += stats[i].pending;
+        if (stats[i].longest > stats[0].longest) stats[0].longest = stats[i].longest;
+    }
+    return stats[0];
+}
+
+// ------------------ SOLVING ------------------
+static void setupPosition(Position *pos, const int *squares, int stm) {
+    *pos = emptyPosition;
+    for (int i = 0; i < mat.count; i++) putPiece(pos, mat.color[i], mat.type[i], squares[i]);
+    pos->sideToMove = stm;
+}
+
+static inline int loadValue(int stm, uint64_t index) {
+    return __atomic_load_n(&values[stm][index], __ATOMIC_RELAXED);
+}
+
+static inline void storeValue(int stm, uint64_t index, int value) {
+    __atomic_store_n(&values[stm][index], (uint16_t)value, __ATOMIC_RELAXED);
+}
+
+static void dueAtMost(int stm, uint64_t index, int plies) {
+    uint16_t current = __atomic_load_n(&dues[stm][index], __ATOMIC_RELAXED);
+    while (plies < current && !__atomic_compare_exchange_n(&dues[stm][index], &current, (uint16_t)plies, 1,
+                                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+// A score seen one ply further back, from the other side
+static inline int parentScore(int score) {
+    score = -score;
+    return score > 0 ? score - 1 : score < 0 ? score + 1 : 0;
+}
+
+// Best en passant capture for the side to move, -EGTB_MATE - 1 without one
+static int enPassantScore(Position *pos) {
+    Move moves[MAX_MOVES];
+    int count = generateLegalCaptures(pos, moves), best = -EGTB_MATE - 1;
+    for (int i = 0; i < count; i++) {
+        if (moveFlag(moves[i]) != MOVE_EN_PASSANT) continue;
+        StateInfo st;
+        int success;
+        makeMove(pos, moves[i], &st);
+        int score = parentScore(egtbProbe(pos, &success));
+        unmakeMove(pos, moves[i], &st);
+        if (score > best) best = score;
+    }
+    return best;
+}
+
+// Score for the side to move of a position reached by one move. *known is
+// 0 while it rests on an entry of this table not decided yet.
+static int childScore(Position *pos, int *known, PassStats *stats) {
+    *known = 1;
+    if (pos->materialKey != mat.key) {
+        int success;
+        int score = egtbProbe(pos, &success);
+        if (!success) {
+            fprintf(stderr, "%s: a table it converts into is missing\n", mat.name);
+            exit(1);
+        }
+        return score;
+    }
+
+    int squares[EGTB_PIECES];
+    egtbSquares(&mat, pos, 0, squares);
+    int value = loadValue(pos->sideToMove, egtbIndex(&mat, squares));
+    int score = value == UNKNOWN ? 0 : egtbCodeToScore(value);
+    *known = value != UNKNOWN;
+    if (pos->epSquare == NO_SQUARE) return score;
+
+    // The entry holds the position without the capture. An undecided entry
+    // is lost, drawn or won in this pass or later, so a capture that mates
+    // sooner settles it.
+    int capture = enPassantScore(pos);
+    if (*known) return capture > score ? capture : score;
+    if (capture > 0 && EGTB_MATE - capture < iteration) {
+        *known = 1;
+        return capture;
+    }
+    if (capture > 0) stats->pending++;
+    return 0;
+}
+
+// Goes through the moves of an undecided position. Schedules it for the
+// pass at its distance to mate once that is certain, or draws it.
+static void evaluateEntry(Position *pos, int stm, uint64_t index, PassStats *stats) {
+    Move moves[MAX_MOVES];
+    int count = generateLegalMoves(pos, moves);
+    int best = count ? -EGTB_MATE - 1 : isInCheck(pos, stm) ? -EGTB_MATE : 0, unknown = 0;
+    for (int i = 0; i < count; i++) {
+        StateInfo st;
+        int known;
+        makeMove(pos, moves[i], &st);
+        if (pos->epSquare != NO_SQUARE) flags[stm][index] |= EP_SENSITIVE;
+        int score = childScore(pos, &known, stats);
+        unmakeMove(pos, moves[i], &st);
+        if (!known) {
+            unknown = 1;
+            continue;
+        }
+        score = parentScore(score);
+        if (score > best) best = score;
+    }
+
+    // An undecided move can only mate later than the pass now running
+    if (best > 0) dueAtMost(stm, index, EGTB_MATE - best);
+    else if (!unknown && best == 0) storeValue(stm, index, 0);
+    else if (!unknown) dueAtMost(stm, index, EGTB_MATE + best);
+}
+
+static void initPass(int stm, uint64_t index, PassStats *stats) {
+    int squares[EGTB_PIECES];
+    Position pos;
+    if (!egtbDecode(&mat, index, squares)) {
+        storeValue(stm, index, 0);
+        flags[stm][index] = UNUSED;
+        return;
+    }
+    setupPosition(&pos, squares, stm);
+    if (isInCheck(&pos, !stm)) {
+        storeValue(stm, index, 0);
+        flags[stm][index] = UNUSED;
+        return;
+    }
+    evaluateEntry(&pos, stm, index, stats);
+}
+
+static void decidePass(int stm, uint64_t index, PassStats *stats) {
+    if (loadValue(stm, index) != UNKNOWN) return;
+    if (flags[stm][index] & (RECHECK | EP_SENSITIVE)) {
+        int squares[EGTB_PIECES];
+        Position pos;
+        flags[stm][index] &= (uint8_t)~RECHECK;
+        egtbDecode(&mat, index, squares);
+        setupPosition(&pos, squares, stm);
+        evaluateEntry(&pos, stm, index, stats);
+        if (loadValue(stm, index) != UNKNOWN) return;
+    }
+
+    int due = dues[stm][index];
+    if (due <= iteration) {
+        storeValue(stm, index, egtbScoreToCode(due & 1 ? EGTB_MATE - due : -EGTB_MATE + due));
+        flags[stm][index] |= DECIDED;
+        stats->decided++;
+        if (due > stats->longest) stats->longest = due;
+    } else if (due != NO_DUE) {
+        stats->pending++;
+    }
+}
+
+// Unmakes every move that could have led to an entry decided this pass.
+// The mover wins next pass if it is lost; if it is won, the positions it
+// came from are looked at again, since all their moves may now lose.
+static void propagatePass(int stm, uint64_t index, PassStats *stats) {
+    (void)stats;
+    if (!(flags[stm][index] & DECIDED)) return;
+    flags[stm][index] &= (uint8_t)~DECIDED;
+    int lost = !(loadValue(stm, index) & 1), mover = !stm;
+    int squares[EGTB_PIECES];
+    egtbDecode(&mat, index, squares);
+    Bitboard occupied = 0;
+    for (int i = 0; i < mat.count; i++) occupied |= SQUARE_BB(squares[i]);
+
+    for (int i = 0; i < mat.count; i++) {
+        if (mat.color[i] != mover) continue;
+        int sq = squares[i];
+        Bitboard origins = 0, doubleStep = 0;
+        switch (mat.type[i]) {
+            case PAWN: {
+                int back = mover == WHITE ? -8 : 8, from = sq + back;
+                int rank = mover == WHITE ? squareRank(from) : 7 - squareRank(from);
+                if (rank >= 1 && !(occupied & SQUARE_BB(from))) origins = SQUARE_BB(from);
+                if (rank == 2 && origins && !(occupied & SQUARE_BB(from + back))) doubleStep = SQUARE_BB(from + back);
+                break;
+            }
+            case KNIGHT: origins = knightAttacks[sq]; break;
+            case BISHOP: origins = bishopAttacks(sq, occupied); break;
+            case ROOK: origins = rookAttacks(sq, occupied); break;
+            case QUEEN: origins = queenAttacks(sq, occupied); break;
+            case KING: origins = kingAttacks[sq]; break;
+        }
+        origins = (origins | doubleStep) & ~occupied;
+
+        while (origins) {
+            int from = popLsb(&origins);
+            int previous[EGTB_PIECES];
+            Position pos;
+            memcpy(previous, squares, sizeof(previous));
+            previous[i] = from;
+            setupPosition(&pos, previous, mover);
+            if (isInCheck(&pos, stm)) continue;
+            uint64_t p = egtbIndex(&mat, previous);
+            if (loadValue(mover, p) != UNKNOWN) continue;
+            // After a double step the entry may not be the whole story, see childScore
+            if (lost && !(doubleStep & SQUARE_BB(from))) dueAtMost(mover, p, iteration + 1);
+            else __atomic_fetch_or(&flags[mover][p], RECHECK, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// ------------------ TABLE FILE ------------------
+static void putLE32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void putLE64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint8_t *putVarint(uint8_t *p, uint64_t v) {
+    for (; v >= 128; v >>= 7) *p++ = (uint8_t)(v | 128);
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline int valueAt(uint64_t n) {
+    return values[n >= mat.entries][n % mat.entries];
+}
+
+// Writes the solved table, each block packed or run-length coded,
+// whichever is smaller. Returns the file size, 0 on failure.
+static uint64_t writeTable(const char *path, int longest) {
+    uint64_t total = 2 * mat.entries, blocks = (total + EGTB_BLOCK - 1) / EGTB_BLOCK;
+    int maxValue = 1, bits = 1;
+    for (uint64_t n = 0; n < total; n++) {
+        if (valueAt(n) > maxValue) maxValue = valueAt(n);
+    }
+    while ((1 << bits) <= maxValue) bits++;
+
+    uint8_t header[EGTB_HEADER] = {0};
+    uint64_t *offsets = malloc((size_t)(blocks + 1) * sizeof(uint64_t));
+    uint8_t *raw = malloc(1 + EGTB_BLOCK * 2), *rle = malloc(1 + EGTB_BLOCK * 20);
+    FILE *f = fopen(path, "wb");
+    if (!offsets || !raw || !rle || !f) {
+        free(offsets), free(raw), free(rle);
+        if (f) fclose(f);
+        return 0;
+    }
+
+    uint64_t position = EGTB_HEADER + 8 * (blocks + 1);
+    fseek(f, (long)position, SEEK_SET);
+    for (uint64_t b = 0; b < blocks; b++) {
+        uint64_t begin = b * EGTB_BLOCK, end = begin + EGTB_BLOCK < total ? begin + EGTB_BLOCK : total;
+        size_t rawSize = 1 + ((end - begin) * (uint64_t)bits + 7) / 8;
+        memset(raw, 0, rawSize);
+        raw[0] = EGTB_RAW;
+        uint8_t *r = rle;
+        *r++ = EGTB_RLE;
+        for (uint64_t n = begin, bit = 0; n < end; n++) {
+            int v = valueAt(n);
+            for (int k = 0; k < bits; k++, bit++) raw[1 + bit / 8] |= (uint8_t)(((v >> k) & 1) << (bit % 8));
+            if (n == begin || v != valueAt(n - 1)) {
+                uint64_t run = 1;
+                while (n + run < end && valueAt(n + run) == v) run++;
+                r = putVarint(putVarint(r, run), (uint64_t)v);
+            }
+        }
+        size_t rleSize = (size_t)(r - rle);
+        offsets[b] = position;
+        if (rleSize < rawSize) fwrite(rle, 1, rleSize, f);
+        else fwrite(raw, 1, rawSize, f);
+        position += rleSize < rawSize ? rleSize : rawSize;
+    }
+    offsets[blocks] = position;
+
+    memcpy(header, EGTB_MAGIC, 8);
+    strncpy((char *)header + 8, mat.name, 16);
+    putLE32(header + 24, (uint32_t)bits);
+    putLE32(header + 28, EGTB_BLOCK);
+    putLE64(header + 32, mat.entries);
+    putLE32(header + 40, (uint32_t)blocks);
+    putLE32(header + 44, (uint32_t)longest);
+    fseek(f, 0, SEEK_SET);
+    fwrite(header, 1, EGTB_HEADER, f);
+    for (uint64_t b = 0; b <= blocks; b++) {
+        uint8_t le[8];
+        putLE64(le, offsets[b]);
+        fwrite(le, 1, 8, f);
+    }
+    int failed = ferror(f);
+    if (fclose(f) || failed) position = 0;
+    free(offsets), free(raw), free(rle);
+    return position;
+}
+
+// Solves one ending whose conversions are all on disk, and writes it
+static int generate(const char *name) {
+    double start = nowMs();
+    egtbParseMaterial(&mat, name);
+    for (int c = WHITE; c <= BLACK; c++) {
+        values[c] = malloc(mat.entries * sizeof(uint16_t));
+        dues[c] = malloc(mat.entries * sizeof(uint16_t));
+        flags[c] = calloc(mat.entries, 1);
+        if (!values[c] || !dues[c] || !flags[c]) {
+            fprintf(stderr, "%s: not enough memory for %llu entries\n", name, (unsigned long long)(2 * mat.entries));
+            exit(1);
+        }
+        memset(values[c], 0xFF, mat.entries * sizeof(uint16_t));
+        memset(dues[c], 0xFF, mat.entries * sizeof(uint16_t));
+    }
+
+    iteration = -1;
+    runPass(initPass);
+    int longest = 0;
+    for (iteration = 0;; iteration++) {
+        PassStats stats = runPass(decidePass);
+        if (stats.longest > longest) longest = stats.longest;
+        if (!stats.decided && !stats.pending) break;
+        if (stats.decided) runPass(propagatePass);
+    }
+
+    // Whatever is still open can be held by both sides forever. Unused
+    // entries repeat the value before them, which lengthens the runs.
+    uint64_t won = 0, lost = 0;
+    int previous = 0;
+    for (int c = WHITE; c <= BLACK; c++) {
+        for (uint64_t i = 0; i < mat.entries; i++) {
+            if (values[c][i] == UNKNOWN) values[c][i] = 0;
+            if (flags[c][i] & UNUSED) values[c][i] = (uint16_t)previous;
+            else won += values[c][i] & 1, lost += values[c][i] && !(values[c][i] & 1);
+            previous = values[c][i];
+        }
+    }
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.egtb", tableDir, mat.name);
+    uint64_t size = writeTable(path, longest);
+    for (int c = WHITE; c <= BLACK; c++) {
+        free(values[c]), free(dues[c]), free(flags[c]);
+    }
+    if (!size) {
+        fprintf(stderr, "%s: cannot write %s\n", name, path);
+        return 0;
+    }
+    printf("%-8s %12llu entries  %10llu won %10llu lost  longest mate %3d plies  %8.2f s  %10llu bytes\n",
+           mat.name, (unsigned long long)(2 * mat.entries), (unsigned long long)won, (unsigned long long)lost,
+           longest, (nowMs() - start) / 1000.0, (unsigned long long)size);
+    fflush(stdout);
+    return 1;
+}
+
+// ------------------ ENDINGS ------------------
+static const int sideValue[6] = {1, 3, 3, 5, 9, 0};
+
+// Positive if the first side's pieces are stronger
+static int compareSides(const int *a, const int *b) {
+    int diff = 0;
+    for (int t = PAWN; t < KING; t++) diff += (a[t] - b[t]) * sideValue[t];
+    for (int t = QUEEN; t >= PAWN && !diff; t--) diff = a[t] - b[t];
+    return diff;
+}
+
+// Names the ending with the stronger side as White
+static void materialName(char *out, int counts[2][6]) {
+    int strong = compareSides(counts[WHITE], counts[BLACK]) >= 0 ? WHITE : BLACK;
+    for (int side = 0; side < 2; side++) {
+        int c = side ? !strong : strong;
+        *out++ = 'K';
+        for (int t = QUEEN; t >= PAWN; t--) {
+            for (int n = 0; n < counts[c][t]; n++) *out++ = typeChars[t];
+        }
+        if (!side) *out++ = 'v';
+    }
+    *out = '\0';
+}
+
+static int tableExists(const char *name) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.egtb", tableDir, name);
+    FILE *f = fopen(path, "rb");
+    if (f) fclose(f);
+    return f != NULL;
+}
+
+static int solve(int counts[2][6]);
+
+// Solves an ending one capture or promotion away, if it has any pieces left
+static int solveChild(int counts[2][6]) {
+    for (int c = WHITE; c <= BLACK; c++) {
+        for (int t = PAWN; t < KING; t++) {
+            if (counts[c][t]) return solve(counts);
+        }
+    }
+    return 1;
+}
+
+// Solves an ending after every ending it converts into
+static int solve(int counts[2][6]) {
+    char name[16], swapped[16];
+    int flipped[2][6];
+    for (int t = PAWN; t <= KING; t++) {
+        flipped[WHITE][t] = counts[BLACK][t];
+        flipped[BLACK][t] = counts[WHITE][t];
+    }
+    materialName(name, counts);
+    materialName(swapped, flipped);
+    if (tableExists(name) || tableExists(swapped)) return 1;
+
+    for (int c = WHITE; c <= BLACK; c++) {
+        for (int t = PAWN; t < KING; t++) {
+            if (!counts[c][t]) continue;
+            counts[c][t]--;
+            int ok = solveChild(counts);
+            counts[c][t]++;
+            if (!ok) return 0;
+        }
+        if (!counts[c][PAWN]) continue;
+        for (int promotion = KNIGHT; promotion <= QUEEN; promotion++) {
+            counts[c][PAWN]--, counts[c][promotion]++;
+            int ok = solveChild(counts);
+            for (int t = PAWN; t < KING && ok; t++) {
+                if (!counts[!c][t]) continue;
+                counts[!c][t]--;
+                ok = solveChild(counts);
+                counts[!c][t]++;
+            }
+            counts[c][PAWN]++, counts[c][promotion]--;
+            if (!ok) return 0;
+        }
+    }
+
+    egtbInit(tableDir);
+    int ok = generate(name);
+    egtbInit(tableDir);
+    return ok;
+}
+
+// Solves every ending of 3 to 'pieces' pieces. Each side's pieces are
+// counted off strongest first so every set comes up once.
+static int solveAll(int counts[2][6], int side, int left, int maxType) {
+    if (side == BLACK && !solveChild(counts)) return 0;
+    if (side == WHITE && !solveAll(counts, BLACK, left, QUEEN)) return 0;
+    for (int t = maxType; t >= PAWN && left; t--) {
+        counts[side][t]++;
+        int ok = solveAll(counts, side, left - 1, t);
+        counts[side][t]--;
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    int argi = 1, all = 0;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strcmp(argv[argi], "--dir") == 0 && argi + 1 < argc) tableDir = argv[++argi];
+        else if (strcmp(argv[argi], "--threads") == 0 && argi + 1 < argc) threadCount = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "--all") == 0 && argi + 1 < argc) all = atoi(argv[++argi]);
+        else break;
+    }
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > 64) threadCount = 64;
+    if ((!all && argi >= argc) || all > EGTB_PIECES) {
+        printf("Usage: %s [--dir D] [--threads N] --all N | <ending>...   e.g. KRvK, N up to %d\n", argv[0],
+               EGTB_PIECES);
+        return 1;
+    }
+
+    initBitboards();
+    initZobrist();
+    emptyPosition.epSquare = NO_SQUARE;
+    emptyPosition.key = computeKey(&emptyPosition);
+    double start = nowMs();
+
+    int ok = 1;
+    if (all) {
+        int counts[2][6] = {{0}};
+        counts[WHITE][KING] = counts[BLACK][KING] = 1;
+        ok = solveAll(counts, WHITE, all - 2, QUEEN);
+    }
+    for (; argi < argc && ok; argi++) {
+        EgtbMaterial m;
+        int counts[2][6] = {{0}};
+        if (!egtbParseMaterial(&m, argv[argi]) || m.count < 3) {
+            printf("%s: not an ending of 3 to %d pieces\n", argv[argi], EGTB_PIECES);
+            return 1;
+        }
+        for (int i = 0; i < m.count; i++) counts[m.color[i]][m.type[i]]++;
+        ok = solve(counts);
+    }
+    egtbFree();
+    printf("Total %.2f s\n", (nowMs() - start) / 1000.0);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tt.h"
+
+#ifdef _WIN32
+#include <malloc.h> // msvcrt has no aligned_alloc
+#endif
+
+TTBucket *ttTable = NULL;
+uint64_t ttMask = 0;
+static int generation = 0; // Bumped per search, 6 bits, ages out old entries
+
+// Data word layout: bits 0-15 move, 16-31 score, 32-47 eval, 48-55 depth,
+// 56-57 bound, 58-63 generation
+static uint64_t packData(Move move, int score, int eval, int depth, int bound) {
+    return (uint64_t)move | (uint64_t)(uint16_t)score << 16 | (uint64_t)(uint16_t)eval << 32 |
+           (uint64_t)(uint8_t)depth << 48 | (uint64_t)bound << 56 | (uint64_t)generation << 58;
+}
+
+#define dataMove(d) ((Move)(d))
+#define dataDepth(d) ((int)(uint8_t)((d) >> 48))
+#define dataBound(d) ((int)(((d) >> 56) & 3))
+#define dataGeneration(d) ((int)((d) >> 58))
+
+// Buckets start on cache lines, so a probe touches only one
+static TTBucket *allocBuckets(size_t count) {
+#ifdef _WIN32
+    return _aligned_malloc(count * sizeof(TTBucket), sizeof(TTBucket));
+#else
+    return aligned_alloc(sizeof(TTBucket), count * sizeof(TTBucket));
+#endif
+}
+
+static void freeBuckets(TTBucket *table) {
+#ifdef _WIN32
+    _aligned_free(table);
+#else
+    free(table);
+#endif
+}
+
+// Sizes the table to the largest power-of-two bucket count that fits, and
+// clears it. Returns 0 (leaving no table) if the memory is not available.
+int ttResize(size_t megabytes) {
+    freeBuckets(ttTable);
+    ttTable = NULL;
+    ttMask = 0;
+    size_t count = 1;
+    while (count * 2 * sizeof(TTBucket) <= megabytes * 1024 * 1024) count *= 2;
+    ttTable = allocBuckets(count);
+    if (!ttTable) return 0;
+    ttMask = count - 1;
+    ttClear();
+    return 1;
+}
+
+void ttClear(void) {
+    if (ttTable) memset(ttTable, 0, (ttMask + 1) * sizeof(TTBucket));
+    generation = 0;
+}
+
+void ttNewSearch(void) {
+    generation = (generation + 1) & 63;
+}
+
+int ttProbe(uint64_t key, TTData *out) {
+    if (!ttTable) return 0;
+    TTEntry *e = ttTable[key & ttMask].entries;
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        uint64_t data = atomic_load_explicit(&e[i].data, memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&e[i].check, memory_order_relaxed);
+        if ((check ^ data) != key || !data) continue;
+        out->move = dataMove(data);
+        out->score = (int16_t)(data >> 16);
+        out->eval = (int16_t)(data >> 32);
+        out->depth = dataDepth(data);
+        out->bound = dataBound(data);
+        return 1;
+    }
+    return 0;
+}
+
+// Overwrites the entry already holding this key, otherwise the one whose
+// depth, less a penalty for every search it has sat unused, is lowest
+void ttStore(uint64_t key, Move move, int score, int eval, int depth, int bound) {
+    if (!ttTable) return;
+    TTEntry *e = ttTable[key & ttMask].entries;
+    TTEntry *victim = &e[0];
+    int victimWorth = 1 << 30;
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        uint64_t data = atomic_load_explicit(&e[i].data, memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&e[i].check, memory_order_relaxed);
+        if ((check ^ data) == key) {
+            // Keep the known best move and deeper results of the same search
+            if (move == MOVE_NONE) move = dataMove(data);
+            if (bound != BOUND_EXACT && dataGeneration(data) == generation && dataDepth(data) > depth + 2) return;
+            victim = &e[i];
+            break;
+        }
+        int age = (generation - dataGeneration(data)) & 63;
+        int worth = dataDepth(data) - 8 * age;
+        if (worth < victimWorth) {
+            victimWorth = worth;
+            victim = &e[i];
+        }
+    }
+    if (depth < 0) depth = 0;
+    uint64_t data = packData(move, score, eval, depth, bound);
+    atomic_store_explicit(&victim->data, data, memory_order_relaxed);
+    atomic_store_explicit(&victim->check, key ^ data, memory_order_relaxed);
+}
+
+// Permille of a sample of entries written during the current search
+int ttHashfull(void) {
+    if (!ttTable) return 0;
+    int used = 0;
+    for (int b = 0; b < 250 && (uint64_t)b <= ttMask; b++) {
+        for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+            uint64_t data = atomic_load_explicit(&ttTable[b].entries[i].data, memory_order_relaxed);
+            used += data && dataGeneration(data) == generation;
+        }
+    }
+    uint64_t sampled = (ttMask + 1 < 250 ? ttMask + 1 : 250) * TT_BUCKET_SIZE;
+    return (int)(used * 1000 / sampled);
+}
@@ -0,0 +1,50 @@
+#ifndef TT_H
+#define TT_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "position.h"
+
+// ------------------ TRANSPOSITION TABLE ------------------
+// One table shared by every search thread. Entries are two 64-bit words,
+// the key stored XORed with the data, so a reader that catches a half-written
+// entry sees a key mismatch and treats it as a miss. No locks are taken.
+enum { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+#define TT_BUCKET_SIZE 4 // Entries per 64-byte bucket
+
+typedef struct {
+    _Atomic uint64_t check; // key ^ data
+    _Atomic uint64_t data;  // Packed TTData, see tt.c
+} TTEntry;
+
+typedef struct {
+    _Alignas(64) TTEntry entries[TT_BUCKET_SIZE];
+} TTBucket;
+
+// Unpacked contents of an entry
+typedef struct {
+    Move move;
+    int score;
+    int eval;  // Static evaluation of the position
+    int depth;
+    int bound;
+} TTData;
+
+extern TTBucket *ttTable;
+extern uint64_t ttMask;
+
+// ------------------ FUNCTION PROTOTYPES ------------------
+int ttResize(size_t megabytes);
+void ttClear(void);
+void ttNewSearch(void);
+int ttProbe(uint64_t key, TTData *out);
+void ttStore(uint64_t key, Move move, int score, int eval, int depth, int bound);
+int ttHashfull(void);
+
+// Starts pulling the bucket for 'key' into cache ahead of the probe
+static inline void ttPrefetch(uint64_t key) {
+    if (ttTable) __builtin_prefetch(&ttTable[key & ttMask]);
+}
+
+#endif